@@ -7,23 +7,198 @@ set (PIPELINE_SOURCES
   src/utils/validators.cpp
   src/utils/antenna_positions.cpp
   src/pipeline/datablob.cpp
+  src/pipeline/packed_acm.cpp
+  src/pipeline/wsf_cost.cpp
+  src/pipeline/subspace.cpp
+  src/pipeline/khatri_rao.cpp
+  src/pipeline/gain_solver.cpp
+  src/pipeline/reduction.cpp
+  src/pipeline/sumthreshold.cpp
+  src/pipeline/rfi_flagger.cpp
+  src/pipeline/antenna_health.cpp
   src/pipeline/pmodules/flagger.cpp
   src/pipeline/pmodules/calibrator.cpp
   src/pipeline/pmodules/weighter.cpp
   src/pipeline/omodules/diskwriter.cpp
   src/pipeline/omodules/tcpclient.cpp
+  src/pipeline/omodules/forwarder.cpp
   src/server/server.cpp
   src/server/stream_handler.cpp
+  src/utils/placement.cpp
   src/server/stream.cpp
+  src/server/deinterleave.cpp
+  src/server/integration_queue.cpp
+  src/server/io_service_pool.cpp
+  src/server/uring_receiver.cpp
+)
+
+# === Simulator sources
+set (SIMULATOR_SOURCES
+  src/simulator/main.cpp
+  src/simulator/simulator.cpp
+  src/utils/utils.cpp
+  src/utils/validators.cpp
+  src/utils/antenna_positions.cpp
+  src/server/deinterleave.cpp
+  src/server/uring_receiver.cpp
 )
 
 # === Test sources
 set (TESTS
   stream_test
+  simulator_test
+  reduction_test
+  sigmaclip_test
+  gauss_newton_test
+  sumthreshold_test
+  antenna_health_test
+  flagger_test
+  packed_acm_test
+  datablob_test
+  wsf_cost_test
+  subspace_test
+  khatri_rao_test
+  gain_solver_test
 )
 
 set (stream_test_SOURCES
+  src/utils/utils.cpp
+  src/utils/placement.cpp
   src/server/stream.cpp
   src/server/stream_handler.cpp
+  src/server/deinterleave.cpp
+  src/server/integration_queue.cpp
+  src/server/uring_receiver.cpp
   src/server/test/stream_test.cpp
 )
+
+set (simulator_test_SOURCES
+  src/utils/utils.cpp
+  src/utils/antenna_positions.cpp
+  src/simulator/simulator.cpp
+  src/simulator/test/simulator_test.cpp
+)
+
+set (reduction_test_SOURCES
+  src/pipeline/reduction.cpp
+  src/pipeline/test/reduction_test.cpp
+)
+
+set (sigmaclip_test_SOURCES
+  src/utils/test/sigmaclip_test.cpp
+)
+
+set (gauss_newton_test_SOURCES
+  src/utils/test/gauss_newton_test.cpp
+)
+
+set (sumthreshold_test_SOURCES
+  src/pipeline/sumthreshold.cpp
+  src/pipeline/rfi_flagger.cpp
+  src/pipeline/test/sumthreshold_test.cpp
+)
+
+set (antenna_health_test_SOURCES
+  src/pipeline/antenna_health.cpp
+  src/pipeline/test/antenna_health_test.cpp
+)
+
+set (flagger_test_SOURCES
+  src/utils/utils.cpp
+  src/utils/antenna_positions.cpp
+  src/simulator/simulator.cpp
+  src/pipeline/datablob.cpp
+  src/pipeline/packed_acm.cpp
+  src/pipeline/reduction.cpp
+  src/pipeline/sumthreshold.cpp
+  src/pipeline/rfi_flagger.cpp
+  src/pipeline/antenna_health.cpp
+  src/pipeline/pmodules/flagger.cpp
+  src/pipeline/test/flagger_test.cpp
+)
+
+set (packed_acm_test_SOURCES
+  src/pipeline/packed_acm.cpp
+  src/pipeline/test/packed_acm_test.cpp
+)
+
+set (datablob_test_SOURCES
+  src/utils/utils.cpp
+  src/pipeline/datablob.cpp
+  src/pipeline/packed_acm.cpp
+  src/pipeline/test/datablob_test.cpp
+)
+
+set (wsf_cost_test_SOURCES
+  src/pipeline/wsf_cost.cpp
+  src/pipeline/test/wsf_cost_test.cpp
+)
+
+set (subspace_test_SOURCES
+  src/pipeline/subspace.cpp
+  src/pipeline/test/subspace_test.cpp
+)
+
+set (khatri_rao_test_SOURCES
+  src/pipeline/khatri_rao.cpp
+  src/pipeline/test/khatri_rao_test.cpp
+)
+
+set (gain_solver_test_SOURCES
+  src/pipeline/gain_solver.cpp
+  src/pipeline/test/gain_solver_test.cpp
+)
+
+# === Benchmark sources
+set (BENCHMARKS
+  deinterleave_bench
+  modules_bench
+  ingest_bench
+  sigmaclip_bench
+  wsf_bench
+  khatri_rao_bench
+  gain_solver_bench
+)
+
+set (deinterleave_bench_SOURCES
+  src/server/deinterleave.cpp
+  src/server/bench/deinterleave_bench.cpp
+)
+
+set (modules_bench_SOURCES
+  src/utils/utils.cpp
+  src/pipeline/datablob.cpp
+  src/pipeline/packed_acm.cpp
+  src/pipeline/reduction.cpp
+  src/pipeline/sumthreshold.cpp
+  src/pipeline/rfi_flagger.cpp
+  src/pipeline/antenna_health.cpp
+  src/pipeline/pmodules/weighter.cpp
+  src/pipeline/pmodules/flagger.cpp
+  src/pipeline/bench/modules_bench.cpp
+)
+
+set (ingest_bench_SOURCES
+  src/server/uring_receiver.cpp
+  src/server/bench/ingest_bench.cpp
+)
+
+set (sigmaclip_bench_SOURCES
+  src/utils/bench/sigmaclip_bench.cpp
+)
+
+set (wsf_bench_SOURCES
+  src/pipeline/wsf_cost.cpp
+  src/pipeline/subspace.cpp
+  src/pipeline/bench/wsf_bench.cpp
+)
+
+set (khatri_rao_bench_SOURCES
+  src/pipeline/khatri_rao.cpp
+  src/pipeline/bench/khatri_rao_bench.cpp
+)
+
+set (gain_solver_bench_SOURCES
+  src/pipeline/gain_solver.cpp
+  src/pipeline/bench/gain_solver_bench.cpp
+)
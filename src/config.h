@@ -5,17 +5,35 @@
 /** Number of polarizations */
 constexpr int NUM_POLARIZATIONS = 2;
 
-/** Number of stations */
-constexpr int NUM_STATIONS = 6;
-
 /** Number of channels per subband */
 constexpr int NUM_CHANNELS = 63;
 
-/** Number of active antennas */
-constexpr int NUM_ANTENNAS = 288;
+/** Number of antennas per station */
+constexpr int NUM_ANTENNAS_PER_STATION = 48;
+
+/**
+ * Array dimensions for a correlator with A active antennas, instantiated for
+ * 288 (6 stations) and 576 (12 stations)
+ */
+template<int A>
+struct Config
+{
+  static_assert(A == 288 || A == 576, "unsupported number of antennas");
 
-/** Number of baselines including self correlation */
-constexpr int NUM_BASELINES = (NUM_ANTENNAS*(NUM_ANTENNAS+1)/2);
+  /** Number of active antennas */
+  static constexpr int NUM_ANTENNAS = A;
 
-/** Number of antennas per station */
-constexpr int NUM_ANTENNAS_PER_STATION = NUM_ANTENNAS/NUM_STATIONS;
+  /** Number of stations */
+  static constexpr int NUM_STATIONS = A/NUM_ANTENNAS_PER_STATION;
+
+  /** Number of baselines including self correlation */
+  static constexpr int NUM_BASELINES = (A*(A+1)/2);
+
+  /** Number of station weights including self correlation */
+  static constexpr int NUM_WEIGHTS = (NUM_STATIONS*(NUM_STATIONS+1)/2);
+};
+
+/** Instantiates class template T for all supported antenna counts */
+#define INSTANTIATE_ANTENNAS(T) \
+  template class T<288>; \
+  template class T<576>;
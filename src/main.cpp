@@ -11,6 +11,7 @@
 #include "utils/antenna_positions.h"
 #include "pipeline/omodules/diskwriter.h"
 #include "pipeline/omodules/tcpclient.h"
+#include "pipeline/omodules/forwarder.h"
 #include "pipeline/pmodules/flagger.h"
 #include "pipeline/pmodules/calibrator.h"
 #include "pipeline/pmodules/weighter.h"
@@ -21,16 +22,120 @@
   "    Flags:    " CALIBRATION_FLAGS "\n" \
   "    Date:     " __DATE__ "\n"
 
-DEFINE_string(affinity, "", "Set cpu affinity. First id is input, last id is output and middle ids for processing e.g. 0,3,4,7");
+DEFINE_string(affinity, "", "Set cpu affinity. First --iothreads ids are input, last id is output and dispatch and middle ids for processing e.g. 0,3,4,7");
+DEFINE_string(channel_affinity, "", "Processing cpus of the channel tier (Weighter and Flagger) e.g. 1,2, the middle ids of --affinity then all calibrate. By default the first half of the middle ids flag and the second half calibrate");
+DEFINE_int32(iothreads, 1, "Number of input threads, each connected stream is served by its own thread");
 DEFINE_int32(antcfg, 0, "0=LBA_OUTER, 1=LBA_INNER, 2=LBA_SPARSE_EVEN, 3=LBA_SPARSE_ODD");
 DEFINE_int32(port, 4000, "Port to listen on for incoming data");
-DEFINE_int32(buffer, 20, "Ringbuffer size in number of seconds");
+DEFINE_int32(buffer, 20, "Ringbuffer size in number of seconds of collapsed integrations ahead of the Calibrator");
+DEFINE_int32(channel_buffer, 2, "Ringbuffer size in number of seconds of channelised integrations ahead of the Flagger");
 DEFINE_string(output, "", "Output locations e.g. 'tcp:127.0.0.1:5000,file:/tmp/calibrated.vis'");
 DEFINE_string(antpos, "", "Antenna positions filename");
 DEFINE_int32(subband, -1, "Lofar subband that defines the frequency of incoming data");
+DEFINE_string(subbands, "", "Subband to port map for multi-subband ingest e.g. '296:4000,297:4001', overrides --subband and --port");
 DEFINE_string(channels, "0-62", "List of channel ranges to use e.g. '0-10,12-30,31-31' (inclusive)");
 DEFINE_double(antsigma, 4.0, "Sigma used for clipping of antennas");
 DEFINE_double(vissigma, 3.0, "Sigma used for clipping of visibilities across channels");
+DEFINE_double(rfisigma, 6.0, "Sigma at which single visibilities are flagged for rfi across channels and time, 0 disables");
+DEFINE_int32(rfiwindow, 3, "Number of past integrations per subband and polarization used to flag rfi in time, at most 15");
+DEFINE_string(rfi_affinity, "", "Cpus of rfi flagging threads shared by all processing threads e.g. 8,9, by default each processing thread flags alone");
+DEFINE_string(flagged_dipoles, "", "Antennas known to be bad e.g. '3,17,250', they are flagged without being looked at");
+DEFINE_string(antenna_power, "acm", "Antenna power to flag on: acm (column means of the ACM), auto (autocorrelations, bad antennas are left out of the reductions) or compare (acm, and logs where auto disagrees)");
+DEFINE_bool(warm_start, true, "Seed the calibration of an integration with the solution of the one right before it of the same subband and polarization");
+DEFINE_string(position_solver, "simplex", "Minimizer of the source position fit: simplex (Nelder-Mead) or gauss-newton (analytic derivatives, far fewer cost evaluations)");
+DEFINE_bool(zerocopy, false, "Receive visibilities straight into pipeline buffers instead of a staging buffer");
+DEFINE_int32(queue_depth, 2, "Number of integrations buffered per stream between ingest and the pipeline");
+DEFINE_string(overload, "block", "Policy when the pipeline falls behind: block, drop-oldest or drop-newest integration");
+DEFINE_string(ingest, "asio", "Receive path: asio or uring (Linux io_uring with batched receives)");
+DEFINE_int32(read_size, 0, "Bytes per receive, must divide the integration size and be a multiple of 64, 0 selects 166464 for 288 and 332352 for 576 antennas");
+DEFINE_string(replay, "", "Recorded correlator files to replay instead of listening, one per subband in --subband(s) order e.g. '/data/sb296.raw,/data/sb297.raw'");
+DEFINE_double(replay_speed, 0.0, "Replay pacing relative to the recorded timestamps, 1 is real time and 0 as fast as possible");
+DEFINE_bool(hugepages, true, "Back integration buffers with transparent huge pages on the NUMA node of the cpu receiving the stream");
+DEFINE_string(deinterleave_kernel, "auto", "De-interleave kernel: auto, scalar, sse4, avx2 or avx512");
+
+/// Runs the pipeline and server for a correlator with NUM_ANTENNAS antennas
+template<int NUM_ANTENNAS>
+void Run(const std::vector<int> &affinity, const std::vector<std::pair<int,int>> &subbands, const std::vector<std::string> &replay)
+{
+  CHECK(Stream<NUM_ANTENNAS>::ValidReadSize(Stream<NUM_ANTENNAS>::ReadSize()))
+    << "--read_size must divide the " << NUM_ANTENNAS << " antenna integration size";
+
+  std::vector<int> input(affinity.begin(), affinity.begin()+FLAGS_iothreads);
+  std::vector<int> middle(affinity.begin()+FLAGS_iothreads, affinity.end()-1);
+
+  // the tiers get their own processing cpus and share the output cpu, where
+  // the Forwarder and the calibration outputs only move data
+  std::vector<int> flagging, calibration;
+  if (!FLAGS_channel_affinity.empty())
+  {
+    flagging = utils::ParseAffinity(FLAGS_channel_affinity);
+    calibration = middle;
+  }
+  else if (middle.size() >= 2)
+  {
+    flagging.assign(middle.begin(), middle.begin() + (middle.size() + 1)/2);
+    calibration.assign(middle.begin() + flagging.size(), middle.end());
+  }
+  else
+    flagging = calibration = middle;
+  flagging.push_back(affinity.back());
+  calibration.push_back(affinity.back());
+
+  // only the Weighter and Flagger need the channels, a few large slots are
+  // recycled as soon as an integration is collapsed to its acm
+  Pipeline<DataBlob<NUM_ANTENNAS>> channels(flagging);
+  channels.CreateMemoryPool(Stream<NUM_ANTENNAS>::DatumSize(), FLAGS_channel_buffer*2*subbands.size());
+  channels.template AddProcessingModule<Weighter<NUM_ANTENNAS>>();
+  // the Flaggers of all processing threads share the rfi history, its workers
+  // and the antenna health, so every integration of a stream is flagged
+  // against its predecessors
+  FlaggerState<NUM_ANTENNAS> flagger_state;
+  channels.template AddProcessingModule<Flagger<NUM_ANTENNAS>>(flagger_state);
+
+  // the calibration and output stages buffer the small collapsed blobs
+  Pipeline<DataBlob<NUM_ANTENNAS>> pipeline(calibration);
+  pipeline.CreateMemoryPool(DataBlob<NUM_ANTENNAS>::CollapsedSize(), FLAGS_buffer*2*subbands.size());
+  // the Calibrators of all processing threads share the last solution of
+  // every subband and polarization, so each integration is seeded by the one before
+  CalibratorState calibrator_state;
+  pipeline.template AddProcessingModule<Calibrator<NUM_ANTENNAS>>(calibrator_state);
+  channels.template AddOutputModule<Forwarder<NUM_ANTENNAS>>(pipeline);
+
+  std::vector<std::string> list;
+  boost::split(list, FLAGS_output, boost::is_any_of(","));
+
+  for (auto &s : list)
+  {
+    if (s.substr(0, 4) == "file")
+      pipeline.template AddOutputModule<DiskWriter>();
+    else if (s.substr(0, 3) == "tcp")
+      pipeline.template AddOutputModule<TcpClient>();
+  }
+  pipeline.Start();
+  channels.Start();
+
+  try
+  {
+    // the acceptors run on this thread, streams on the input threads and the
+    // dispatcher that feeds the pipeline shares the output cpu
+    boost::asio::io_service io_service;
+    IoServicePool pool(input);
+    std::unique_ptr<Server<NUM_ANTENNAS>> s;
+    if (replay.empty())
+      s.reset(new Server<NUM_ANTENNAS>(io_service, pool, channels, subbands, affinity.back()));
+    else
+      s.reset(new Server<NUM_ANTENNAS>(io_service, pool, channels, subbands, replay, affinity.back()));
+    io_service.run();
+    pool.Stop();
+  }
+  catch (std::exception& e)
+  {
+    LOG(ERROR) << e.what();
+  }
+
+  channels.Stop();
+  pipeline.Stop();
+}
 
 int main(int argc, char *argv[])
 {
@@ -39,13 +144,31 @@ int main(int argc, char *argv[])
 
   ::google::RegisterFlagValidator(&FLAGS_antsigma, &val::ValidateSigma);
   ::google::RegisterFlagValidator(&FLAGS_vissigma, &val::ValidateSigma);
+  ::google::RegisterFlagValidator(&FLAGS_rfisigma, &val::ValidateNonNegative);
+  ::google::RegisterFlagValidator(&FLAGS_rfiwindow, &val::ValidateRFIWindow);
+  ::google::RegisterFlagValidator(&FLAGS_rfi_affinity, &val::ValidateCpuList);
+  ::google::RegisterFlagValidator(&FLAGS_flagged_dipoles, &val::ValidateAntennaList);
+  ::google::RegisterFlagValidator(&FLAGS_antenna_power, &val::ValidateAntennaPower);
+  ::google::RegisterFlagValidator(&FLAGS_position_solver, &val::ValidatePositionSolver);
   ::google::RegisterFlagValidator(&FLAGS_subband, &val::ValidateSubband);
+  ::google::RegisterFlagValidator(&FLAGS_subbands, &val::ValidateSubbands);
   ::google::RegisterFlagValidator(&FLAGS_port, &val::ValidatePort);
   ::google::RegisterFlagValidator(&FLAGS_affinity, &val::ValidateAffinity);
+  ::google::RegisterFlagValidator(&FLAGS_channel_affinity, &val::ValidateCpuList);
+  ::google::RegisterFlagValidator(&FLAGS_iothreads, &val::ValidateThreads);
   ::google::RegisterFlagValidator(&FLAGS_channels, &val::ValidateChannels);
   ::google::RegisterFlagValidator(&FLAGS_output, &val::ValidateOutput);
   ::google::RegisterFlagValidator(&FLAGS_antpos, &val::ValidateFile);
   ::google::RegisterFlagValidator(&FLAGS_antcfg, &val::ValidateAntCfg);
+  ::google::RegisterFlagValidator(&FLAGS_deinterleave_kernel, &val::ValidateKernel);
+  ::google::RegisterFlagValidator(&FLAGS_buffer, &val::ValidateBuffer);
+  ::google::RegisterFlagValidator(&FLAGS_channel_buffer, &val::ValidateBuffer);
+  ::google::RegisterFlagValidator(&FLAGS_queue_depth, &val::ValidateQueueDepth);
+  ::google::RegisterFlagValidator(&FLAGS_overload, &val::ValidateOverload);
+  ::google::RegisterFlagValidator(&FLAGS_ingest, &val::ValidateIngest);
+  ::google::RegisterFlagValidator(&FLAGS_read_size, &val::ValidateReadSize);
+  ::google::RegisterFlagValidator(&FLAGS_replay, &val::ValidateReplay);
+  ::google::RegisterFlagValidator(&FLAGS_replay_speed, &val::ValidateNonNegative);
 
   ::google::SetUsageMessage(USAGE);
   ::google::SetVersionString(VERSION_STRING);
@@ -55,46 +178,37 @@ int main(int argc, char *argv[])
 
   VLOG(1) << CALIBRATION_HUMAN_NAME;
 
+  auto subbands = utils::ParseSubbands(FLAGS_subbands);
+  if (subbands.empty())
+    subbands.push_back(std::make_pair(FLAGS_subband, FLAGS_port));
+  CHECK(subbands[0].first >= 0) << "No subband given, use --subband or --subbands";
+
+  std::vector<std::string> replay;
+  if (!FLAGS_replay.empty())
+    boost::split(replay, FLAGS_replay, boost::is_any_of(","));
+  CHECK(replay.empty() || replay.size() == subbands.size()) << "--replay needs one file per subband";
+  CHECK(FLAGS_overload != "block" || FLAGS_iothreads >= int(subbands.size()))
+    << "--overload block needs an io thread per stream, a blocked stream would stall the others on its thread";
+
+  // antenna positions are shared by all subbands
   AntennaPositions::CreateInstance(FLAGS_antpos);
+  VLOG(1) << "Using " << Stream<288>::SelectKernel(FLAGS_deinterleave_kernel) << " de-interleave kernel";
 
   auto affinity = utils::ParseAffinity(FLAGS_affinity);
+  CHECK(int(affinity.size()) > FLAGS_iothreads) << "--affinity needs more cpus than --iothreads";
   cpu_set_t cpuset;
   CPU_ZERO(&cpuset);
   CPU_SET(affinity.back(), &cpuset);
   int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
   CHECK(rc == 0) << "pthread_setaffinity_np failed for cpu " << affinity.back();
-  Pipeline<DataBlob> pipeline(std::vector<int>(affinity.begin()+1, affinity.end()));
-  pipeline.CreateMemoryPool(
-      NUM_BASELINES*NUM_CHANNELS*sizeof(std::complex<float>) + sizeof(output_header_t),
-      FLAGS_buffer*2);
-  pipeline.AddProcessingModule<Weighter>();
-  pipeline.AddProcessingModule<Flagger>();
-  pipeline.AddProcessingModule<Calibrator>();
-
-  std::vector<std::string> list;
-  boost::split(list, FLAGS_output, boost::is_any_of(","));
-
-  for (auto &s : list)
-  {
-    if (s.substr(0, 4) == "file")
-      pipeline.AddOutputModule<DiskWriter>();
-    else if (s.substr(0, 3) == "tcp")
-      pipeline.AddOutputModule<TcpClient>();
-  }
-  pipeline.Start();
-
-  try
-  {
-    boost::asio::io_service io_service;
-    Server s(io_service, pipeline, FLAGS_port);
-    io_service.run();
-  }
-  catch (std::exception& e)
-  {
-    LOG(ERROR) << e.what();
-  }
 
-  pipeline.Stop();
+  // the antenna positions determine which array geometry is instantiated
+  int num_antennas = AntennaPositions::Instance()->NumAntennas();
+  VLOG(1) << "Processing " << num_antennas << " antennas";
+  if (num_antennas == 576)
+    Run<576>(affinity, subbands, replay);
+  else
+    Run<288>(affinity, subbands, replay);
 
   return 0;
 }
@@ -0,0 +1,117 @@
+#include "antenna_health.h"
+#include "../config.h"
+
+#include <algorithm>
+#include <cmath>
+
+/// Weight of a new integration in the exponentially weighted statistics
+#define ALPHA 0.05f
+/// Relative spread assumed for an antenna with very steady power
+#define MIN_SPREAD 0.02f
+/// Consecutive integrations with the same flags before they are trusted
+#define STABLE_INTEGRATIONS 10
+/// Consecutive integrations an antenna is flagged before it is skipped
+#define BAD_INTEGRATIONS 10
+/// Every this many integrations skipped antennas are checked again
+#define RECHECK_INTEGRATIONS 60
+
+template<int NUM_ANTENNAS>
+AntennaHealth<NUM_ANTENNAS>::State::State():
+  mean(Eigen::VectorXf::Zero(NUM_ANTENNAS)),
+  var(Eigen::VectorXf::Zero(NUM_ANTENNAS)),
+  mask(Eigen::VectorXf::Zero(NUM_ANTENNAS)),
+  bad(NUM_ANTENNAS, 0),
+  skip(NUM_ANTENNAS, 0),
+  stable(0),
+  integrations(0)
+{
+}
+
+template<int NUM_ANTENNAS>
+AntennaHealth<NUM_ANTENNAS>::AntennaHealth(const std::vector<int> &dead, const float sigma):
+  mDead(NUM_ANTENNAS, 0),
+  mSigma(sigma)
+{
+  for (auto a : dead)
+    if (a >= 0 && a < NUM_ANTENNAS)
+      mDead[a] = 1;
+}
+
+template<int NUM_ANTENNAS>
+void AntennaHealth<NUM_ANTENNAS>::Skip(const int key, std::vector<uint8_t> &skip)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  auto s = mStates.find(key);
+  if (s == mStates.end() || s->second.integrations % RECHECK_INTEGRATIONS == RECHECK_INTEGRATIONS - 1)
+    skip = mDead;
+  else
+    skip = s->second.skip;
+}
+
+template<int NUM_ANTENNAS>
+bool AntennaHealth<NUM_ANTENNAS>::Expected(const int key, const Eigen::VectorXf &power, const Eigen::VectorXf &mask)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  auto s = mStates.find(key);
+  if (s == mStates.end() || s->second.stable < STABLE_INTEGRATIONS)
+    return false;
+
+  State &state = s->second;
+  for (int i = 0; i < NUM_ANTENNAS; i++)
+  {
+    if (!mask(i))
+      continue;
+
+    // an antenna that was flagged last time needs a full check
+    if (!state.mask(i))
+      return false;
+
+    float spread = std::max(std::sqrt(state.var(i)), MIN_SPREAD * state.mean(i));
+    if (std::abs(power(i) - state.mean(i)) > mSigma * spread)
+      return false;
+  }
+
+  return true;
+}
+
+template<int NUM_ANTENNAS>
+void AntennaHealth<NUM_ANTENNAS>::Update(const int key, const Eigen::VectorXf &power, const Eigen::VectorXf &mask)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  State &state = mStates[key];
+
+  if (state.integrations > 0 && mask == state.mask)
+    state.stable++;
+  else
+    state.stable = 1;
+
+  for (int i = 0; i < NUM_ANTENNAS; i++)
+  {
+    if (mask(i))
+    {
+      state.bad[i] = 0;
+      if (state.mean(i) == 0.0f)
+      {
+        state.mean(i) = power(i);
+        state.var(i) = 0.0f;
+      }
+      else
+      {
+        float d = power(i) - state.mean(i);
+        state.mean(i) += ALPHA * d;
+        state.var(i) = (1.0f - ALPHA) * (state.var(i) + ALPHA * d * d);
+      }
+    }
+    else
+    {
+      state.bad[i]++;
+    }
+
+    state.skip[i] = mDead[i] || state.bad[i] >= BAD_INTEGRATIONS;
+  }
+
+  state.mask = mask;
+  state.integrations++;
+}
+
+INSTANTIATE_ANTENNAS(AntennaHealth)
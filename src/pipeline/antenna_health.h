@@ -0,0 +1,58 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+/**
+ * Tracks the power of every antenna over consecutive integrations of the same
+ * subband and polarization. Antennas in the static list or flagged in a
+ * number of consecutive integrations are known bad and left out of the
+ * reductions, a periodic integration includes the learned ones again so they
+ * can recover. Once the flags have not changed for a while, the antenna
+ * powers are compared against their exponentially weighted means instead of
+ * being sigma clipped. One instance is shared by the Flaggers of all
+ * processing threads, so the counts are per stream whichever thread sees an
+ * integration, every call takes a lock.
+ */
+template<int NUM_ANTENNAS>
+class AntennaHealth
+{
+public:
+  AntennaHealth(const std::vector<int> &dead, const float sigma);
+
+  /// Fills skip with the antennas to leave out of the next integration of key, one per antenna
+  void Skip(const int key, std::vector<uint8_t> &skip);
+
+  /**
+   * @brief
+   * Returns true when the flags of the previous integration of key still
+   * hold, every antenna in mask is within sigma of its expected power. mask
+   * is left untouched.
+   */
+  bool Expected(const int key, const Eigen::VectorXf &power, const Eigen::VectorXf &mask);
+
+  /// Updates the statistics of key with the final antenna mask of an integration
+  void Update(const int key, const Eigen::VectorXf &power, const Eigen::VectorXf &mask);
+
+private:
+  struct State
+  {
+    State();
+
+    Eigen::VectorXf mean;
+    Eigen::VectorXf var;
+    Eigen::VectorXf mask;
+    std::vector<int> bad;
+    std::vector<uint8_t> skip;
+    int stable;
+    int integrations;
+  };
+
+  std::vector<uint8_t> mDead;
+  float mSigma;
+  std::mutex mMutex;
+  std::map<int, State> mStates;
+};
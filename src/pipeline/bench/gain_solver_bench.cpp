@@ -0,0 +1,91 @@
+#include <benchmark/benchmark.h>
+#include "../gain_solver.h"
+
+#define CYCLES 10
+
+/// Models and data of range(1) polarizations of range(0) antennas, the gains take all cycles to converge
+struct Polarizations
+{
+  Polarizations(const int n, const int polarizations)
+  {
+    std::srand(5);
+    for (int b = 0; b < polarizations; b++)
+    {
+      Eigen::MatrixXcf A = Eigen::MatrixXcf::Random(n, 5);
+      Eigen::MatrixXcf M = A * A.adjoint();
+      Eigen::VectorXcf g = Eigen::VectorXcf::Ones(n) + 0.3f * Eigen::VectorXcf::Random(n);
+      Eigen::MatrixXcf noise = Eigen::MatrixXcf::Random(n, n);
+      Eigen::MatrixXcf R = g.asDiagonal() * M * g.adjoint().asDiagonal();
+      R += 0.5f * (noise + noise.adjoint());
+      M.diagonal().setZero();
+      R.diagonal().setZero();
+      model.push_back(M);
+      data.push_back(R);
+    }
+  }
+
+  std::vector<Eigen::MatrixXcf> model;
+  std::vector<Eigen::MatrixXcf> data;
+};
+
+/// The minor cycles as the calibrator did them with Eigen, one polarization after the other
+static void BM_GainSolvEigen(benchmark::State &state)
+{
+  Polarizations p(state.range(0), state.range(1));
+  const int n = state.range(0);
+  Eigen::MatrixXcf data_normalised(n, n);
+  Eigen::MatrixXcf data_calibrated(n, n);
+  Eigen::VectorXcf estimated(n);
+  Eigen::VectorXcf gains(n);
+  Eigen::VectorXcf tmp(n);
+  for (auto _ : state)
+    for (std::size_t b = 0; b < p.model.size(); b++)
+    {
+      for (int i = 0; i < n; i++)
+      {
+        data_normalised.col(i) = p.data[b].col(i) / p.data[b].col(i).dot(p.data[b].col(i));
+        data_calibrated.col(i) = p.model[b].col(i);
+      }
+      for (int i = 1; i <= CYCLES; i++)
+      {
+        for (int j = 0; j < n; j++)
+          gains(j) = 1.0f / std::conj(data_normalised.col(j).dot(data_calibrated.col(j)));
+        if (i % 2 == 1)
+          tmp = gains;
+        else
+          gains = (gains + tmp) / 2.0f;
+        for (int j = 0; j < n; j++)
+          data_calibrated.col(j) = gains.array() * p.model[b].col(j).array();
+      }
+      benchmark::DoNotOptimize(gains.data());
+    }
+}
+
+static void BM_GainSolver(benchmark::State &state, const std::string &kernel)
+{
+  if (!gainsolve::Supported(kernel))
+  {
+    state.SkipWithError("kernel not supported by this cpu");
+    return;
+  }
+
+  Polarizations p(state.range(0), state.range(1));
+  const Eigen::VectorXcf initial = Eigen::VectorXcf::Ones(state.range(0));
+  GainSolver solver(kernel);
+  std::vector<GainSolver::Problem> batch;
+  for (auto _ : state)
+  {
+    batch.clear();
+    for (std::size_t b = 0; b < p.model.size(); b++)
+      batch.push_back(GainSolver::Problem(p.model[b], p.data[b], initial));
+    solver.Solve(batch, CYCLES, 0.0f);
+    benchmark::DoNotOptimize(batch[0].gains.data());
+  }
+}
+
+BENCHMARK(BM_GainSolvEigen)->Args({288, 1})->Args({288, 2})->Args({576, 1})->Args({576, 2})->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_GainSolver, scalar, std::string("scalar"))->Args({288, 1})->Args({288, 2})->Args({576, 1})->Args({576, 2})->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_GainSolver, avx2, std::string("avx2"))->Args({288, 1})->Args({288, 2})->Args({576, 1})->Args({576, 2})->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_GainSolver, avx512, std::string("avx512"))->Args({288, 1})->Args({288, 2})->Args({576, 1})->Args({576, 2})->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,78 @@
+#include <benchmark/benchmark.h>
+#include "../khatri_rao.h"
+#include "../../utils/utils.h"
+
+/// An acm model of range(0) antennas and range(1) sources, the autocorrelations and a tenth of the baselines masked
+struct Model
+{
+  Model(const int n, const int nsrc):
+    A(Eigen::MatrixXcf::Random(n, nsrc)),
+    mask(Eigen::MatrixXf::Ones(n, n))
+  {
+    std::srand(5);
+    for (int i = 0; i < n; i++)
+    {
+      mask(i, i) = 0.0f;
+      for (int j = 0; j < i; j++)
+        if (std::rand() % 10 == 0)
+          mask(i, j) = mask(j, i) = 0.0f;
+    }
+    Eigen::MatrixXcf r = Eigen::MatrixXcf::Random(n, n);
+    data = (r + r.adjoint()).array() * mask.array();
+  }
+
+  Eigen::MatrixXcf A;
+  Eigen::MatrixXf mask;
+  Eigen::MatrixXcf data;
+};
+
+/// The flux solve of a major cycle of walsCalibration with the explicit Khatri-Rao product
+static void BM_FluxesExplicit(benchmark::State &state)
+{
+  Model m(state.range(0), state.range(1));
+  const int n = m.A.rows(), nsrc = m.A.cols();
+  const int rows = (m.mask.array() > 0.5f).count();
+  Eigen::MatrixXcf rest(rows, nsrc);
+  Eigen::MatrixXcf data(rows, 1);
+  Eigen::MatrixXcf pinv(nsrc, nsrc);
+  for (auto _ : state)
+  {
+    Eigen::MatrixXcf M(n*n, nsrc);
+    utils::khatrirao<std::complex<float>>(m.A.conjugate(), m.A, M);
+    for (int j = 0, k = 0; j < m.mask.size(); j++)
+      if (m.mask(j) > 0.5f)
+      {
+        rest.row(k) = M.row(j);
+        data(k) = m.data(j);
+        k++;
+      }
+    utils::pseudoInverse<std::complex<float>>(rest.adjoint()*rest, pinv);
+    Eigen::VectorXf fluxes = (pinv * rest.adjoint() * data).real();
+    benchmark::DoNotOptimize(fluxes.data());
+  }
+  state.counters["temporary_MB"] = (double(n) * n + rows) * nsrc * sizeof(std::complex<float>) / 1e6;
+}
+
+static void BM_FluxesStructured(benchmark::State &state)
+{
+  Model m(state.range(0), state.range(1));
+  const int nsrc = m.A.cols();
+  const std::vector<int> excluded = khatri_rao::Excluded(m.mask);
+  Eigen::MatrixXcf gram;
+  Eigen::VectorXcf projection;
+  Eigen::MatrixXcf pinv(nsrc, nsrc);
+  for (auto _ : state)
+  {
+    khatri_rao::Gram(m.A, excluded, gram);
+    khatri_rao::Project(m.A, m.data, projection);
+    utils::pseudoInverse<std::complex<float>>(gram, pinv);
+    Eigen::VectorXf fluxes = (pinv * projection).real();
+    benchmark::DoNotOptimize(fluxes.data());
+  }
+  state.counters["temporary_MB"] = ((double(m.A.rows()) + excluded.size()) * nsrc * sizeof(std::complex<float>) + excluded.size() * sizeof(int)) / 1e6;
+}
+
+BENCHMARK(BM_FluxesExplicit)->Args({288, 5})->Args({576, 5})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_FluxesStructured)->Args({288, 5})->Args({576, 5})->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
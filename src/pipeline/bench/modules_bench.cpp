@@ -0,0 +1,190 @@
+#include "../datablob.h"
+#include "../pmodules/weighter.h"
+#include "../pmodules/flagger.h"
+#include "../reduction.h"
+#include "../rfi_flagger.h"
+#include "../../config.h"
+
+#include <benchmark/benchmark.h>
+#include <glog/logging.h>
+#include <random>
+#include <thread>
+
+DEFINE_double(antsigma, 4.0, "Sigma used for clipping of antennas");
+DEFINE_double(vissigma, 3.0, "Sigma used for clipping of visibilities across channels");
+DEFINE_double(rfisigma, 6.0, "Sigma at which single visibilities are flagged for rfi across channels and time, 0 disables");
+DEFINE_int32(rfiwindow, 3, "Number of past integrations per subband and polarization used to flag rfi in time, at most 15");
+DEFINE_string(flagged_dipoles, "", "Antennas known to be bad e.g. '3,17,250', they are flagged without being looked at");
+DEFINE_string(antenna_power, "acm", "Antenna power to flag on: acm (column means of the ACM), auto (autocorrelations, bad antennas are left out of the reductions) or compare (acm, and logs where auto disagrees)");
+DEFINE_string(rfi_affinity, "", "Cpus of rfi flagging threads shared by all processing threads e.g. 8,9, by default each processing thread flags alone");
+
+/// Fills a datum with a header and gaussian visibilities
+template<int NUM_ANTENNAS>
+static void Fill(Datum &datum)
+{
+  datum.resize(sizeof(output_header_t) + Config<NUM_ANTENNAS>::NUM_BASELINES*NUM_CHANNELS*sizeof(std::complex<float>));
+  memset(datum.data(), 0, sizeof(output_header_t));
+  output_header_t *hdr = reinterpret_cast<output_header_t*>(datum.data());
+  hdr->num_antennas = NUM_ANTENNAS;
+  hdr->num_channels = NUM_CHANNELS + 1;
+  hdr->flagged_channels[0] = true;
+  for (int i = 0; i < Config<NUM_ANTENNAS>::NUM_WEIGHTS; i++)
+    hdr->weights[i] = 1000 + i;
+
+  std::mt19937 gen(42);
+  std::normal_distribution<float> normal(1.0f, 0.1f);
+  std::complex<float> *v = reinterpret_cast<std::complex<float>*>(datum.data() + sizeof(output_header_t));
+  for (int i = 0, n = Config<NUM_ANTENNAS>::NUM_BASELINES*NUM_CHANNELS; i < n; i++)
+    v[i] = std::complex<float>(normal(gen), normal(gen));
+}
+
+template<int NUM_ANTENNAS>
+static void BM_Weighter(benchmark::State &state)
+{
+  Datum datum;
+  Fill<NUM_ANTENNAS>(datum);
+  DataBlob<NUM_ANTENNAS> blob;
+  Weighter<NUM_ANTENNAS> weighter;
+  blob.Prepare(datum);
+  weighter.Initialize(blob);
+
+  for (auto _ : state)
+    weighter.Run(blob);
+
+  state.SetBytesProcessed(int64_t(state.iterations()) * (datum.size() - sizeof(output_header_t)));
+}
+
+/// The Flagger with antenna powers from the ACM (0) or the autocorrelations (1)
+template<int NUM_ANTENNAS>
+static void BM_Flagger(benchmark::State &state)
+{
+  Datum datum, copy;
+  Fill<NUM_ANTENNAS>(copy);
+  DataBlob<NUM_ANTENNAS> blob;
+  FLAGS_antenna_power = state.range(0) ? "auto" : "acm";
+  Flagger<NUM_ANTENNAS> flagger;
+  blob.Prepare(copy);
+  flagger.Initialize(blob);
+
+  for (auto _ : state)
+  {
+    state.PauseTiming();
+    datum = copy;
+    blob.Prepare(datum);
+    state.ResumeTiming();
+    flagger.Run(blob);
+  }
+
+  state.SetBytesProcessed(int64_t(state.iterations()) * (datum.size() - sizeof(output_header_t)));
+}
+
+/// Station weights of the header as the Weighter normalizes them
+template<int NUM_ANTENNAS>
+static Eigen::VectorXf Weights(Datum &datum)
+{
+  output_header_t *hdr = reinterpret_cast<output_header_t*>(datum.data());
+  Eigen::VectorXf w(Config<NUM_ANTENNAS>::NUM_WEIGHTS);
+  for (int i = 0; i < w.size(); i++)
+    w(i) = hdr->weights[i];
+  return w / w.maxCoeff();
+}
+
+/// Weighting and channel reduction as separate Eigen passes, in place
+template<int NUM_ANTENNAS>
+static void BM_ReductionUnfused(benchmark::State &state)
+{
+  const int N = Config<NUM_ANTENNAS>::NUM_BASELINES;
+  Datum datum, copy;
+  Fill<NUM_ANTENNAS>(copy);
+  Eigen::VectorXf weights = Weights<NUM_ANTENNAS>(copy);
+  Eigen::VectorXf mask = Eigen::VectorXf::Ones(NUM_CHANNELS);
+  mask(10) = 0.0f;
+
+  for (auto _ : state)
+  {
+    state.PauseTiming();
+    datum = copy;
+    state.ResumeTiming();
+
+    Eigen::Map<Eigen::MatrixXcf, Eigen::Aligned>
+      raw(reinterpret_cast<std::complex<float>*>(datum.data()+sizeof(output_header_t)), NUM_CHANNELS, N);
+    for (int a0 = 0, b = 0; a0 < NUM_ANTENNAS; a0++)
+      for (int a1 = 0; a1 <= a0; a1++, b++)
+      {
+        int s0 = a0/NUM_ANTENNAS_PER_STATION, s1 = a1/NUM_ANTENNAS_PER_STATION;
+        raw.col(b) *= weights(s0*(s0+1)/2 + s1);
+      }
+    Eigen::VectorXf channels = raw.rowwise().mean().array().abs();
+    Eigen::MatrixXf vismask = mask.replicate(1, N);
+    raw.array() *= vismask.array();
+    Eigen::VectorXcf result = raw.colwise().sum().array() / vismask.colwise().sum().array();
+    benchmark::DoNotOptimize(channels.data());
+    benchmark::DoNotOptimize(result.data());
+  }
+
+  state.SetBytesProcessed(int64_t(state.iterations()) * (datum.size() - sizeof(output_header_t)));
+}
+
+/// Weighting and channel reduction in two read only passes over the first range(0) channels
+template<int NUM_ANTENNAS>
+static void BM_ReductionFused(benchmark::State &state)
+{
+  const int channels = state.range(0);
+  Datum datum;
+  Fill<NUM_ANTENNAS>(datum);
+  Eigen::VectorXf weights = Weights<NUM_ANTENNAS>(datum);
+  Eigen::VectorXf mask = Eigen::VectorXf::Ones(channels);
+  mask(10) = 0.0f;
+  Eigen::VectorXcd sums(NUM_CHANNELS);
+  Eigen::VectorXcf result(Config<NUM_ANTENNAS>::NUM_BASELINES);
+  const std::complex<float> *raw = reinterpret_cast<std::complex<float>*>(datum.data()+sizeof(output_header_t));
+
+  for (auto _ : state)
+  {
+    reduction::ChannelSums(raw, NUM_ANTENNAS, channels, weights.data(), nullptr, sums.data());
+    reduction::MaskedMeans(raw, NUM_ANTENNAS, channels, weights.data(), nullptr, mask.data(), nullptr, result.data());
+    benchmark::DoNotOptimize(sums.data());
+    benchmark::DoNotOptimize(result.data());
+  }
+
+  state.SetBytesProcessed(int64_t(state.iterations()) * Config<NUM_ANTENNAS>::NUM_BASELINES*channels*sizeof(std::complex<float>));
+}
+
+/// Flagging of single visibilities in consecutive integrations with range(0) additional threads
+template<int NUM_ANTENNAS>
+static void BM_RFIFlagger(benchmark::State &state)
+{
+  Datum datum, copy;
+  Fill<NUM_ANTENNAS>(copy);
+  std::vector<int> affinity;
+  for (int i = 0; i < state.range(0); i++)
+    affinity.push_back((i + 1) % std::thread::hardware_concurrency());
+  RFIFlagger<NUM_ANTENNAS> flagger(FLAGS_rfisigma, FLAGS_rfiwindow, affinity);
+  std::vector<uint64_t> flags(Config<NUM_ANTENNAS>::NUM_BASELINES);
+  double time = 0.0;
+
+  for (auto _ : state)
+  {
+    state.PauseTiming();
+    datum = copy;
+    state.ResumeTiming();
+    auto raw = reinterpret_cast<std::complex<float>*>(datum.data()+sizeof(output_header_t));
+    benchmark::DoNotOptimize(flagger.Run(raw, NUM_CHANNELS, 0, time, time + 1.0, flags.data()));
+    time += 1.0;
+  }
+
+  state.SetBytesProcessed(int64_t(state.iterations()) * (datum.size() - sizeof(output_header_t)));
+}
+
+BENCHMARK_TEMPLATE(BM_Weighter, 288)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Weighter, 576)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Flagger, 288)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Flagger, 576)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_RFIFlagger, 288)->Arg(0)->Arg(3)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_RFIFlagger, 576)->Arg(0)->Arg(3)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ReductionUnfused, 288)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_ReductionUnfused, 576)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_ReductionFused, 288)->Arg(NUM_CHANNELS)->Arg(32)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_ReductionFused, 576)->Arg(NUM_CHANNELS)->Arg(32)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
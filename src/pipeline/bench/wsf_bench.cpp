@@ -0,0 +1,271 @@
+#include <benchmark/benchmark.h>
+#include "../wsf_cost.h"
+#include "../subspace.h"
+#include "../../utils/NMSMax.h"
+#include "../../utils/gauss_newton.h"
+
+using namespace Eigen;
+
+/// The WSF cost as the Calibrator computed it before, with the dense N x N projector
+class DenseWSFCost
+{
+public:
+  DenseWSFCost(const MatrixXcf &EsWEs, const MatrixXcf &G, const double freq, const MatrixXd &P, const int n):
+    W(EsWEs), G(G), P(P), nsrc(n), i1(0.0, 2.0 * M_PI * freq / 299792458.0f),
+    Eye(MatrixXcf::Identity(P.rows(), P.rows())) {}
+
+  float operator()(const VectorXd &theta) {
+    MatrixXd src_pos(nsrc, 3);
+    src_pos.col(0) = theta.head(nsrc).array().cos() * theta.tail(nsrc).array().cos();
+    src_pos.col(1) = theta.head(nsrc).array().sin() * theta.tail(nsrc).array().cos();
+    src_pos.col(2) = theta.tail(nsrc).array().sin();
+    MatrixXcf T = (-i1 * (P * src_pos.transpose())).array().exp().cast<std::complex<float>>();
+    MatrixXcf A = G * T;
+    MatrixXcf PAperp = Eye.array() - (A * (A.adjoint() * A).lu().solve(A.adjoint())).array();
+    return (PAperp * W).trace().real();
+  }
+
+private:
+  const MatrixXcf &W;
+  const MatrixXcf &G;
+  const MatrixXd &P;
+  const int nsrc;
+  std::complex<double> i1;
+  MatrixXcf Eye;
+};
+
+/// Data of a WSF position search with range(0) antennas and range(1) sources
+struct Problem
+{
+  Problem(const int n, const int nsrc) {
+    std::srand(7);
+    P = MatrixXd::Random(n, 3) * 150.0;
+    MatrixXcf r = MatrixXcf::Random(n, n);
+    SelfAdjointEigenSolver<MatrixXcf> solver(r * r.adjoint());
+    Es = solver.eigenvectors().rightCols(nsrc);
+    w = VectorXf::Random(nsrc).array().abs() + 0.5f;
+    g = VectorXcf::Random(n).array() + std::complex<float>(1.0f, 0.0f);
+    theta = VectorXd::Random(2*nsrc).array().abs() * 0.5;
+  }
+
+  MatrixXd P;
+  MatrixXcf Es;
+  VectorXf w;
+  VectorXcf g;
+  VectorXd theta;
+};
+
+static void BM_DenseWSFCost(benchmark::State &state)
+{
+  Problem p(state.range(0), state.range(1));
+  MatrixXcf EsWEs = p.Es * p.w.cast<std::complex<float>>().asDiagonal() * p.Es.adjoint();
+  MatrixXcf G = p.g.asDiagonal().toDenseMatrix();
+  DenseWSFCost cost(EsWEs, G, 58e6, p.P, state.range(1));
+  for (auto _ : state)
+    benchmark::DoNotOptimize(cost(p.theta));
+}
+
+static void BM_WSFCost(benchmark::State &state)
+{
+  Problem p(state.range(0), state.range(1));
+  WSFCost cost(p.Es, p.w, p.g, 58e6, p.P);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(cost(p.theta));
+}
+
+static void BM_WSFDerivatives(benchmark::State &state)
+{
+  Problem p(state.range(0), state.range(1));
+  WSFCost cost(p.Es, p.w, p.g, 58e6, p.P);
+  VectorXd gradient;
+  MatrixXd hessian;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(cost(p.theta, gradient, hessian));
+}
+
+/// The simplex of wsfSrcPos with either cost
+static void BM_DenseWSFSrcPos(benchmark::State &state)
+{
+  Problem p(state.range(0), state.range(1));
+  MatrixXcf EsWEs = p.Es * p.w.cast<std::complex<float>>().asDiagonal() * p.Es.adjoint();
+  MatrixXcf G = p.g.asDiagonal().toDenseMatrix();
+  DenseWSFCost cost(EsWEs, G, 58e6, p.P, state.range(1));
+  int cycles = 0;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(NM::Simplex(cost, p.theta, cycles, 1e-3, 1000));
+  state.counters["cycles"] = cycles;
+}
+
+static void BM_WSFSrcPos(benchmark::State &state)
+{
+  Problem p(state.range(0), state.range(1));
+  WSFCost cost(p.Es, p.w, p.g, 58e6, p.P);
+  int cycles = 0;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(NM::Simplex(cost, p.theta, cycles, 1e-3, 1000));
+  state.counters["cycles"] = cycles;
+}
+
+/**
+ * Signal subspace of nsrc sources in the noisy covariance of n antennas of a
+ * station, as the Calibrator sees it after whitening. The position search
+ * starts from directions off by a fraction of the beam, as the catalogue
+ * positions are under ionospheric offsets.
+ */
+struct Sky
+{
+  Sky(const int n, const int nsrc, const int seed): freq(58e6) {
+    std::srand(seed);
+    P = MatrixXd::Random(n, 3) * 40.0;
+    P.col(2) *= 0.01;
+    P.rowwise() += RowVector3d(3826577.0, 461022.0, 5064892.0);
+
+    truth.resize(2*nsrc);
+    truth.head(nsrc) = VectorXd::Random(nsrc) * M_PI;
+    truth.tail(nsrc) = VectorXd::Random(nsrc).array() * 0.4 + 0.8;
+    init = truth + VectorXd::Random(2*nsrc) * 3e-3;
+
+    g = VectorXcf::Random(n) * 0.1f + VectorXcf::Ones(n);
+    MatrixXd src_pos(nsrc, 3);
+    src_pos.col(0) = truth.head(nsrc).array().cos() * truth.tail(nsrc).array().cos();
+    src_pos.col(1) = truth.head(nsrc).array().sin() * truth.tail(nsrc).array().cos();
+    src_pos.col(2) = truth.tail(nsrc).array().sin();
+    std::complex<double> K(0.0, -2.0 * M_PI * freq / 299792458.0);
+    MatrixXcf A = (K * (P * src_pos.transpose())).array().exp().cast<std::complex<float>>();
+    A = (1.0f / g.array()).conjugate().matrix().asDiagonal() * A;
+
+    // sample covariance of a second of data, which leaves noise in the subspace
+    MatrixXcf noise = MatrixXcf::Random(n, n) * 0.02f;
+    VectorXf flux = VectorXf::LinSpaced(nsrc, 10.0f, 2.0f);
+    MatrixXcf R = A * flux.cast<std::complex<float>>().asDiagonal() * A.adjoint() + MatrixXcf::Identity(n, n) + noise + noise.adjoint();
+    SelfAdjointEigenSolver<MatrixXcf> solver(R);
+    Es = solver.eigenvectors().rightCols(nsrc);
+    VectorXf values = solver.eigenvalues().tail(nsrc);
+    w = (values.array() - 1.0f).square() / values.array();
+  }
+
+  /// Largest angle in arc minutes between the directions of a and b
+  static double Distance(const VectorXd &a, const VectorXd &b) {
+    const int nsrc = a.size() / 2;
+    double distance = 0.0;
+    for (int i = 0; i < nsrc; i++)
+    {
+      double c = std::cos(a(i) - b(i)) * std::cos(a(nsrc+i)) * std::cos(b(nsrc+i)) + std::sin(a(nsrc+i)) * std::sin(b(nsrc+i));
+      distance = std::max(distance, std::acos(std::min(c, 1.0)) * 180.0 / M_PI * 60.0);
+    }
+    return distance;
+  }
+
+  double freq;
+  MatrixXd P;
+  MatrixXcf Es;
+  VectorXf w;
+  VectorXcf g;
+  VectorXd truth;
+  VectorXd init;
+};
+
+/// Counts the evaluations of the cost, with or without derivatives
+struct Counted
+{
+  Counted(WSFCost &cost): cost(cost), evaluations(0) {}
+
+  float operator()(const VectorXd &theta) {
+    evaluations++;
+    return cost(theta);
+  }
+
+  float operator()(const VectorXd &theta, VectorXd &gradient, MatrixXd &hessian) {
+    evaluations++;
+    return cost(theta, gradient, hessian);
+  }
+
+  WSFCost &cost;
+  int evaluations;
+};
+
+/// The position search of wsfSrcPos with the simplex for range(2) == 0 and Gauss-Newton otherwise, over range(1) skies
+static void BM_PositionSolver(benchmark::State &state)
+{
+  const int n = state.range(0), nsrc = 3, skies = state.range(1);
+  std::vector<Sky> sky;
+  std::vector<VectorXd> simplex;
+  for (int k = 0; k < skies; k++)
+  {
+    sky.emplace_back(n, nsrc, k + 1);
+    WSFCost cost(sky[k].Es, sky[k].w, sky[k].g, sky[k].freq, sky[k].P);
+    int cycles = 0;
+    simplex.push_back(NM::Simplex(cost, sky[k].init, cycles, 1e-3, 1000));
+  }
+
+  double evaluations = 0.0, cycles = 0.0, error = 0.0, agreement = 0.0;
+  for (auto _ : state)
+  {
+    evaluations = cycles = error = agreement = 0.0;
+    for (int k = 0; k < skies; k++)
+    {
+      WSFCost cost(sky[k].Es, sky[k].w, sky[k].g, sky[k].freq, sky[k].P);
+      Counted counted(cost);
+      int c = 0;
+      VectorXd theta = state.range(2) ? NLS::GaussNewton(counted, sky[k].init, c, 1e-3, 1000)
+                                      : NM::Simplex(counted, sky[k].init, c, 1e-3, 1000);
+      evaluations += counted.evaluations;
+      cycles += c;
+      error = std::max(error, Sky::Distance(theta, sky[k].truth));
+      agreement = std::max(agreement, Sky::Distance(theta, simplex[k]));
+    }
+  }
+  state.counters["evaluations"] = evaluations / skies;
+  state.counters["cycles"] = cycles / skies;
+  state.counters["error_arcmin"] = error;
+  state.counters["simplex_arcmin"] = agreement;
+}
+
+/// A whitened acm of range(0) antennas with three strong sources on the noise floor
+static MatrixXcf Whitened(const int n, const int seed)
+{
+  std::srand(seed);
+  MatrixXcf A = MatrixXcf::Random(n, 3);
+  return A * VectorXcf::LinSpaced(3, 30.0f, 10.0f).asDiagonal() * A.adjoint() + MatrixXcf::Identity(n, n);
+}
+
+static void BM_EigenSolver(benchmark::State &state)
+{
+  MatrixXcf R = Whitened(state.range(0), 7);
+  for (auto _ : state)
+  {
+    SelfAdjointEigenSolver<MatrixXcf> solver(R);
+    benchmark::DoNotOptimize(solver.eigenvectors().data());
+  }
+}
+
+/// Cold from a random basis with range(1) == 0, warm from the subspace of a nearby acm otherwise
+static void BM_Dominant(benchmark::State &state)
+{
+  MatrixXcf R = Whitened(state.range(0), 7);
+  MatrixXcf previous;
+  VectorXf values;
+  if (state.range(1))
+    subspace::Dominant(R + 0.01f * Whitened(state.range(0), 8), 3, previous, values);
+
+  int iterations = 0;
+  for (auto _ : state)
+  {
+    MatrixXcf Q = previous;
+    iterations = subspace::Dominant(R, 3, Q, values);
+    benchmark::DoNotOptimize(Q.data());
+  }
+  state.counters["iterations"] = iterations;
+}
+
+BENCHMARK(BM_DenseWSFCost)->Args({288, 3})->Args({576, 3})->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_WSFCost)->Args({288, 3})->Args({576, 3})->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_WSFDerivatives)->Args({288, 3})->Args({576, 3})->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_DenseWSFSrcPos)->Args({288, 3})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_WSFSrcPos)->Args({288, 3})->Args({576, 3})->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_PositionSolver)->Args({288, 8, 0})->Args({288, 8, 1})->Args({576, 8, 0})->Args({576, 8, 1})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_EigenSolver)->Arg(288)->Arg(576)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Dominant)->Args({288, 0})->Args({288, 1})->Args({576, 0})->Args({576, 1})->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
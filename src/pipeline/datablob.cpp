@@ -6,40 +6,53 @@
 #include "../config.h"
 #include "../utils/utils.h"
 
-DataBlob::DataBlob()
+template<int NUM_ANTENNAS>
+DataBlob<NUM_ANTENNAS>::DataBlob()
 {
-  mACM.resize(NUM_ANTENNAS, NUM_ANTENNAS);
-  mMask.resize(NUM_ANTENNAS, NUM_ANTENNAS);
+  mWeights.setOnes(Config<NUM_ANTENNAS>::NUM_WEIGHTS);
 }
 
-void DataBlob::Prepare(Datum &data)
+template<int NUM_ANTENNAS>
+std::size_t DataBlob<NUM_ANTENNAS>::CollapsedSize()
+{
+  return sizeof(output_header_t) + Config<NUM_ANTENNAS>::NUM_BASELINES * sizeof(std::complex<float>);
+}
+
+template<int NUM_ANTENNAS>
+void DataBlob<NUM_ANTENNAS>::Prepare(Datum &data)
 {
   mDatum = &data;
   mHdr = reinterpret_cast<output_header_t*>(data.data());
-  mACM.setZero();
-  mMask.setIdentity();
-  mHdr->flagged_dipoles.reset();
+  mWeights.setOnes();
   mHdr->ateam.reset();
   for (int i = 0; i < 5; i++)
     mHdr->ateam_flux[i] = 0.0f;
+
+  // a blob forwarded by the channel pipeline keeps its flags and acm, see
+  // Forwarder::Write, and carries the regular magic from here on
+  if (mHdr->magic == FORWARDED_MAGIC)
+  {
+    mHdr->magic = OUTPUT_MAGIC;
+    memcpy(mACM.data(), data.data() + sizeof(output_header_t), mACM.size() * sizeof(std::complex<float>));
+    return;
+  }
+
+  mACM.SetZero();
+  mHdr->flagged_dipoles.reset();
 }
 
-void DataBlob::Clear(Datum &datum)
+template<int NUM_ANTENNAS>
+void DataBlob<NUM_ANTENNAS>::Clear(Datum &datum)
 {
   memset(datum.data(), 0, datum.size());
 }
 
-Datum DataBlob::Serialize()
+template<int NUM_ANTENNAS>
+Datum DataBlob<NUM_ANTENNAS>::Serialize()
 {
-  Datum d(NUM_BASELINES * sizeof(std::complex<float>) + sizeof(output_header_t));
+  Datum d(CollapsedSize());
   memcpy(d.data(), mHdr, sizeof(output_header_t));
-
-  std::complex<float> *c(reinterpret_cast<std::complex<float>*>(d.data()+sizeof(output_header_t)));
-
-  for (int a1 = 0, i = 0; a1 < NUM_ANTENNAS; a1++)
-    for (int a2 = 0; a2 < a1+1; a2++, i++)
-      c[i] = mACM(a1, a2);
-
+  memcpy(d.data()+sizeof(output_header_t), mACM.data(), mACM.size() * sizeof(std::complex<float>));
   return d;
 }
 
@@ -51,7 +64,8 @@ inline double GetRealTime()
 }
 
 
-std::string DataBlob::Name()
+template<int NUM_ANTENNAS>
+std::string DataBlob<NUM_ANTENNAS>::Name()
 {
   auto unix_timestamp = GetRealTime();
   std::stringstream ss;
@@ -73,7 +87,8 @@ std::string DataBlob::Name()
   return ss.str();
 }
 
-float DataBlob::CentralFrequency()
+template<int NUM_ANTENNAS>
+float DataBlob<NUM_ANTENNAS>::CentralFrequency()
 {
   int start = 0, end = mHdr->num_channels-1;
 
@@ -92,17 +107,22 @@ float DataBlob::CentralFrequency()
   return utils::Range2Frequency(mHdr->subband, start, end);
 }
 
-double DataBlob::CentralTimeMJD()
+template<int NUM_ANTENNAS>
+double DataBlob<NUM_ANTENNAS>::CentralTimeMJD()
 {
   return utils::UnixTime2MJD(CentralTimeUnix());
 }
 
-double DataBlob::CentralTimeUnix()
+template<int NUM_ANTENNAS>
+double DataBlob<NUM_ANTENNAS>::CentralTimeUnix()
 {
   return 0.5*(mHdr->start_time+mHdr->end_time);
 }
 
-bool DataBlob::IsValid()
+template<int NUM_ANTENNAS>
+bool DataBlob<NUM_ANTENNAS>::IsValid()
 {
   return mHdr->flagged_dipoles.count() < NUM_ANTENNAS*0.8;
 }
+
+INSTANTIATE_ANTENNAS(DataBlob)
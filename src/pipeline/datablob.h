@@ -3,11 +3,14 @@
 #include <Eigen/Dense>
 #include <pipeline/output_module_interface.h>
 #include "../server/packet.h"
+#include "packed_acm.h"
 
+template<int NUM_ANTENNAS>
 class DataBlob
 {
 public:
   DataBlob();
+  static std::size_t CollapsedSize(); ///< size of a serialized blob, the header followed by the packed acm
   Datum Serialize();
   void Prepare(Datum &datum);
   void Clear(Datum &datum);
@@ -19,7 +22,7 @@ public:
 
   output_header_t *mHdr;
   Datum *mDatum;
-  Eigen::MatrixXcf mACM;
-  Eigen::MatrixXf mMask;
+  PackedACM<NUM_ANTENNAS> mACM; ///< lower triangle, flagged dipoles are zero
+  Eigen::VectorXf mWeights; ///< normalized station weights, applied to the visibilities by the Flagger
 };
 
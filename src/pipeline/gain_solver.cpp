@@ -0,0 +1,207 @@
+#include "gain_solver.h"
+#include "../utils/cpu_features.h"
+
+#include <immintrin.h>
+#include <cmath>
+
+/// Floats of a padded real or imaginary part, a multiple of the widest kernel
+#define STRIDE(n) (((n) + 15) / 16 * 16)
+
+namespace gainsolve
+{
+
+void Scalar(const float *P, const float *g, const int n, const int stride, const int batch, float *est)
+{
+  for (int j = 0; j < n; j++)
+    for (int b = 0; b < batch; b++)
+    {
+      const float *pr = P + (std::size_t(j) * batch + b) * 2 * stride, *pi = pr + stride;
+      const float *gr = g + std::size_t(b) * 2 * stride, *gi = gr + stride;
+
+      float re = 0.0f, im = 0.0f;
+      for (int p = 0; p < n; p++)
+      {
+        re += pr[p] * gr[p] - pi[p] * gi[p];
+        im += pr[p] * gi[p] + pi[p] * gr[p];
+      }
+      est[2*(b*n + j)] = re;
+      est[2*(b*n + j) + 1] = im;
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static inline float Sum(const __m256 x)
+{
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_movehdup_ps(s));
+  return _mm_cvtss_f32(s);
+}
+
+__attribute__((target("avx2,fma")))
+void AVX2(const float *P, const float *g, const int n, const int stride, const int batch, float *est)
+{
+  for (int j = 0; j < n; j++)
+    for (int b = 0; b < batch; b++)
+    {
+      const float *pr = P + (std::size_t(j) * batch + b) * 2 * stride, *pi = pr + stride;
+      const float *gr = g + std::size_t(b) * 2 * stride, *gi = gr + stride;
+
+      // the padding is zero, so whole vectors up to n are summed
+      __m256 rr = _mm256_setzero_ps(), ii = _mm256_setzero_ps();
+      __m256 ri = _mm256_setzero_ps(), ir = _mm256_setzero_ps();
+      for (int p = 0; p < n; p += 8)
+      {
+        __m256 a = _mm256_loadu_ps(pr + p), c = _mm256_loadu_ps(pi + p);
+        __m256 x = _mm256_loadu_ps(gr + p), y = _mm256_loadu_ps(gi + p);
+        rr = _mm256_fmadd_ps(a, x, rr);
+        ii = _mm256_fmadd_ps(c, y, ii);
+        ri = _mm256_fmadd_ps(a, y, ri);
+        ir = _mm256_fmadd_ps(c, x, ir);
+      }
+      est[2*(b*n + j)] = Sum(_mm256_sub_ps(rr, ii));
+      est[2*(b*n + j) + 1] = Sum(_mm256_add_ps(ri, ir));
+    }
+}
+
+__attribute__((target("avx512f")))
+void AVX512(const float *P, const float *g, const int n, const int stride, const int batch, float *est)
+{
+  for (int j = 0; j < n; j++)
+    for (int b = 0; b < batch; b++)
+    {
+      const float *pr = P + (std::size_t(j) * batch + b) * 2 * stride, *pi = pr + stride;
+      const float *gr = g + std::size_t(b) * 2 * stride, *gi = gr + stride;
+
+      __m512 rr = _mm512_setzero_ps(), ii = _mm512_setzero_ps();
+      __m512 ri = _mm512_setzero_ps(), ir = _mm512_setzero_ps();
+      for (int p = 0; p < n; p += 16)
+      {
+        __m512 a = _mm512_loadu_ps(pr + p), c = _mm512_loadu_ps(pi + p);
+        __m512 x = _mm512_loadu_ps(gr + p), y = _mm512_loadu_ps(gi + p);
+        rr = _mm512_fmadd_ps(a, x, rr);
+        ii = _mm512_fmadd_ps(c, y, ii);
+        ri = _mm512_fmadd_ps(a, y, ri);
+        ir = _mm512_fmadd_ps(c, x, ir);
+      }
+      est[2*(b*n + j)] = _mm512_reduce_add_ps(_mm512_sub_ps(rr, ii));
+      est[2*(b*n + j) + 1] = _mm512_reduce_add_ps(_mm512_add_ps(ri, ir));
+    }
+}
+
+static const std::vector<cpu::Variant<Kernel>> &Variants()
+{
+  static const std::vector<cpu::Variant<Kernel>> variants = {
+    {"scalar", 0, Scalar},
+    {"avx2", cpu::AVX2 | cpu::FMA, AVX2},
+    {"avx512", cpu::AVX512F, AVX512}
+  };
+  return variants;
+}
+
+std::vector<std::string> Names()
+{
+  return cpu::Names(Variants());
+}
+
+bool Supported(const std::string &name)
+{
+  return cpu::Supported(Variants(), name);
+}
+
+Kernel Select(const std::string &name)
+{
+  return cpu::Select(Variants(), name);
+}
+
+} // namespace gainsolve
+
+GainSolver::GainSolver(const std::string &kernel):
+  mKernel(gainsolve::Select(kernel))
+{
+}
+
+void GainSolver::Solve(std::vector<Problem> &batch, const int max_cycles, const float epsilon)
+{
+  const int B = batch.size();
+  if (B == 0)
+    return;
+
+  const int n = batch[0].model->rows();
+  const int stride = STRIDE(n);
+  mP.assign(std::size_t(n) * B * 2 * stride, 0.0f);
+  mG.assign(std::size_t(B) * 2 * stride, 0.0f);
+  mEst.resize(2 * B * n);
+
+  // P = conj(Rn) .* M with the columns of the data normalised by their power
+  for (int b = 0; b < B; b++)
+  {
+    const Eigen::MatrixXcf &R = *batch[b].data;
+    const Eigen::MatrixXcf &M = *batch[b].model;
+    for (int j = 0; j < n; j++)
+    {
+      float *pr = &mP[(std::size_t(j) * B + b) * 2 * stride], *pi = pr + stride;
+      const float *r = reinterpret_cast<const float*>(R.col(j).data());
+      const float *m = reinterpret_cast<const float*>(M.col(j).data());
+      const float scale = 1.0f / R.col(j).squaredNorm();
+
+      // spelled out, std::complex multiplication is not vectorized for its inf and nan checks
+      for (int p = 0; p < n; p++)
+      {
+        pr[p] = (r[2*p] * m[2*p] + r[2*p+1] * m[2*p+1]) * scale;
+        pi[p] = (r[2*p] * m[2*p+1] - r[2*p+1] * m[2*p]) * scale;
+      }
+    }
+  }
+
+  std::vector<Eigen::VectorXcf> previous(B);
+  std::vector<bool> done(B, false);
+  for (int b = 0; b < B; b++)
+  {
+    batch[b].cycles = max_cycles;
+    for (int p = 0; p < n; p++)
+    {
+      mG[b*2*stride + p] = batch[b].gains(p).real();
+      mG[b*2*stride + stride + p] = batch[b].gains(p).imag();
+    }
+  }
+
+  int remaining = B;
+  for (int i = 1; i <= max_cycles && remaining > 0; i++)
+  {
+    mKernel(mP.data(), mG.data(), n, stride, B, mEst.data());
+
+    for (int b = 0; b < B; b++)
+    {
+      if (done[b])
+        continue;
+
+      Problem &problem = batch[b];
+      for (int j = 0; j < n; j++)
+        problem.gains(j) = 1.0f / std::conj(std::complex<float>(mEst[2*(b*n + j)], mEst[2*(b*n + j) + 1]));
+
+      if (i % 2 == 1)
+        previous[b] = problem.gains;
+      else
+      {
+        // average with the gains of the previous cycle and check for convergence
+        Eigen::VectorXcf last = problem.gains;
+        problem.gains = (problem.gains + previous[b]) / 2.0f;
+        problem.residue = (problem.gains - last).norm() / problem.gains.norm();
+        if (problem.residue <= epsilon)
+        {
+          problem.cycles = i;
+          done[b] = true;
+          remaining--;
+          continue;
+        }
+      }
+
+      for (int p = 0; p < n; p++)
+      {
+        mG[b*2*stride + p] = problem.gains(p).real();
+        mG[b*2*stride + stride + p] = problem.gains(p).imag();
+      }
+    }
+  }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <string>
+#include <vector>
+
+/**
+ * Kernels of the minor cycles of the gain solver. A minor cycle estimates
+ * every gain from one column of the normalised data and the model,
+ *
+ *   est(j) = sum_p conj(Rn(p,j)) M(p,j) g(p) = sum_p P(p,j) g(p)
+ *
+ * and P only changes between calls of the solver, so it is formed once and
+ * a cycle is a single pass over it. P of all problems of a batch is stored
+ * column by column with the columns of the problems next to each other, the
+ * real and imaginary parts of a column apart and padded to STRIDE floats. A
+ * cycle then streams P once for the whole batch while the gains of the batch
+ * stay in the L1 cache.
+ */
+namespace gainsolve
+{
+/**
+ * @brief
+ * est[2 (b n + j) + {0, 1}] = sum_p P(p,j) g(p) of problem b for the batch
+ * problems of n antennas in P and g, laid out as above with stride floats per
+ * real or imaginary part.
+ */
+typedef void (*Kernel)(const float *P, const float *g, const int n, const int stride, const int batch, float *est);
+
+void Scalar(const float *P, const float *g, const int n, const int stride, const int batch, float *est);
+void AVX2(const float *P, const float *g, const int n, const int stride, const int batch, float *est);
+void AVX512(const float *P, const float *g, const int n, const int stride, const int batch, float *est);
+
+/// Names of all compiled kernels, fastest last
+std::vector<std::string> Names();
+
+/// True when the kernel exists and the cpu supports it, "auto" is always supported
+bool Supported(const std::string &name);
+
+/// Returns the kernel by name, "auto" selects the fastest supported kernel
+Kernel Select(const std::string &name);
+}
+
+/**
+ * Solves the gains g of the model M of the data R of one or more problems at
+ * once, typically the two polarizations or several subbands of an
+ * integration, by the alternating least squares of StEFCal: every even
+ * minor cycle averages the gains of the last two, until their relative
+ * change is below epsilon or after max_cycles. Problems that converged are
+ * left alone while the others continue.
+ */
+class GainSolver
+{
+public:
+  struct Problem
+  {
+    Problem(const Eigen::MatrixXcf &model, const Eigen::MatrixXcf &data, const Eigen::VectorXcf &gains):
+      model(&model), data(&data), gains(gains), cycles(0), residue(0.0f) {}
+
+    const Eigen::MatrixXcf *model;
+    const Eigen::MatrixXcf *data;
+    Eigen::VectorXcf gains; ///< initial gains, replaced by the solution
+    int cycles;             ///< minor cycles until convergence
+    float residue;          ///< relative change of the gains in the last cycle
+  };
+
+  GainSolver(const std::string &kernel = "auto");
+
+  /// Solves all problems of batch, they have the same number of antennas
+  void Solve(std::vector<Problem> &batch, const int max_cycles, const float epsilon);
+
+private:
+  gainsolve::Kernel mKernel;
+  std::vector<float> mP;
+  std::vector<float> mG;
+  std::vector<float> mEst;
+};
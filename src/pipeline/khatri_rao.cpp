@@ -0,0 +1,37 @@
+#include "khatri_rao.h"
+
+namespace khatri_rao
+{
+std::vector<int> Excluded(const Eigen::MatrixXf &mask)
+{
+  std::vector<int> excluded;
+  for (int i = 0; i < mask.size(); i++)
+    if (!(mask(i) > 0.5f))
+      excluded.push_back(i);
+  return excluded;
+}
+
+void Project(const Eigen::MatrixXcf &A, const Eigen::MatrixXcf &R, Eigen::VectorXcf &projection)
+{
+  Eigen::MatrixXcf RA = R * A;
+  projection.resize(A.cols());
+  for (int k = 0; k < A.cols(); k++)
+    projection(k) = A.col(k).dot(RA.col(k));
+}
+
+void Gram(const Eigen::MatrixXcf &A, const std::vector<int> &excluded, Eigen::MatrixXcf &gram)
+{
+  const int n = A.rows();
+  const int m = A.cols();
+  gram = (A.adjoint() * A).cwiseAbs2().cast<std::complex<float>>();
+
+  // row p + n q of K holds conj(A(q,k)) A(p,k)
+  Eigen::MatrixXcf K(excluded.size(), m);
+  for (std::size_t i = 0; i < excluded.size(); i++)
+  {
+    const int p = excluded[i] % n, q = excluded[i] / n;
+    K.row(i) = A.row(q).conjugate().cwiseProduct(A.row(p));
+  }
+  gram.noalias() -= K.adjoint() * K;
+}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <vector>
+
+/**
+ * Normal equations of the source fluxes s in the model R = A diag(s) A^H of
+ * an acm. With the Khatri-Rao product K = conj(A) o A the model is
+ * vec(R) = K s, but K has N^2 rows and is never needed itself:
+ *
+ *   K^H vec(R) = diag(A^H R A)    K^H K = |A^H A|^2 (element wise)
+ *
+ * A mask that leaves visibilities out of the fit removes their rows of K,
+ * which is a correction of K^H K over the masked visibilities only. These
+ * are the autocorrelations and the short baselines, a small part of the acm.
+ */
+namespace khatri_rao
+{
+/// Column major indices of the visibilities left out by mask, those not above one half
+std::vector<int> Excluded(const Eigen::MatrixXf &mask);
+
+/// K^H vec(R) for K = conj(A) o A, R should already be masked
+void Project(const Eigen::MatrixXcf &A, const Eigen::MatrixXcf &R, Eigen::VectorXcf &projection);
+
+/// K^H K for K = conj(A) o A without the rows of the excluded visibilities
+void Gram(const Eigen::MatrixXcf &A, const std::vector<int> &excluded, Eigen::MatrixXcf &gram);
+}
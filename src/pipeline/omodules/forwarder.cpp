@@ -0,0 +1,36 @@
+#include "forwarder.h"
+#include "../../config.h"
+
+#include <glog/logging.h>
+#include <sstream>
+
+template<int NUM_ANTENNAS>
+Forwarder<NUM_ANTENNAS>::Forwarder(Pipeline<DataBlob<NUM_ANTENNAS>> &target):
+  mTarget(target),
+  mForwarded(0)
+{
+}
+
+template<int NUM_ANTENNAS>
+std::string Forwarder<NUM_ANTENNAS>::Name()
+{
+  std::stringstream ss;
+  ss << "Forwarder: " << mForwarded;
+  return ss.str();
+}
+
+template<int NUM_ANTENNAS>
+void Forwarder<NUM_ANTENNAS>::Initialize()
+{
+}
+
+template<int NUM_ANTENNAS>
+void Forwarder<NUM_ANTENNAS>::Write(Datum &datum)
+{
+  CHECK(datum.size() == DataBlob<NUM_ANTENNAS>::CollapsedSize());
+  reinterpret_cast<output_header_t*>(datum.data())->magic = FORWARDED_MAGIC;
+  mTarget.SwapAndProcess(datum);
+  mForwarded++;
+}
+
+INSTANTIATE_ANTENNAS(Forwarder)
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <pipeline/output_module_interface.h>
+#include <pipeline/pipeline.h>
+#include <cstdint>
+
+#include "../datablob.h"
+
+/**
+ * Hands the serialized blobs of the channel pipeline, header and packed acm,
+ * to the calibration pipeline. The header magic marks them as forwarded so
+ * DataBlob::Prepare keeps their flags and acm. The datum is swapped with a
+ * slot of the calibration pool, so the Forwarder must be the only output module.
+ */
+template<int NUM_ANTENNAS>
+class Forwarder : public OutputModuleInterface
+{
+public:
+  /// target receives the blobs, it must outlive the channel pipeline
+  explicit Forwarder(Pipeline<DataBlob<NUM_ANTENNAS>> &target);
+
+  virtual void Initialize();
+  virtual void Write(Datum &datum);
+  virtual std::string Name();
+
+private:
+  Pipeline<DataBlob<NUM_ANTENNAS>> &mTarget;
+  uint64_t mForwarded;
+};
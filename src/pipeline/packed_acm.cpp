@@ -0,0 +1,101 @@
+#include "packed_acm.h"
+#include "../config.h"
+
+#include <algorithm>
+
+template<int NUM_ANTENNAS>
+PackedACM<NUM_ANTENNAS>::PackedACM():
+  mData(Eigen::VectorXcf::Zero(Config<NUM_ANTENNAS>::NUM_BASELINES))
+{
+}
+
+template<int NUM_ANTENNAS>
+void PackedACM<NUM_ANTENNAS>::SetZero()
+{
+  mData.setZero();
+}
+
+template<int NUM_ANTENNAS>
+void PackedACM<NUM_ANTENNAS>::ZeroAntenna(const int i)
+{
+  std::complex<float> *row = Row(i);
+  for (int j = 0; j <= i; j++)
+    row[j] = 0.0f;
+
+  // column i below the diagonal, one element in every following row
+  std::size_t b = std::size_t(i + 1)*(i + 2)/2 + i;
+  for (int k = i + 1; k < NUM_ANTENNAS; k++, b += k)
+    mData[b] = 0.0f;
+}
+
+template<int NUM_ANTENNAS>
+void PackedACM<NUM_ANTENNAS>::Sanitize()
+{
+  mData = (mData.array() != mData.array()).select(std::complex<float>(0.0f, 0.0f), mData);
+  for (int i = 0; i < NUM_ANTENNAS; i++)
+    Row(i)[i].imag(0.0f);
+}
+
+template<int NUM_ANTENNAS>
+std::complex<float> PackedACM<NUM_ANTENNAS>::operator()(const int i, const int j) const
+{
+  return j <= i ? Row(i)[j] : std::conj(Row(j)[i]);
+}
+
+template<int NUM_ANTENNAS>
+void PackedACM<NUM_ANTENNAS>::ColumnMeans(Eigen::VectorXf &means) const
+{
+  // column i is the conjugate of row i, both have the same absolute mean
+  Eigen::VectorXcf sums = Eigen::VectorXcf::Zero(NUM_ANTENNAS);
+  for (int i = 0; i < NUM_ANTENNAS; i++)
+  {
+    const std::complex<float> *row = Row(i);
+    std::complex<float> s = row[i];
+    for (int j = 0; j < i; j++)
+    {
+      s += row[j];
+      sums[j] += std::conj(row[j]);
+    }
+    sums[i] += s;
+  }
+  means = sums.array().abs() / float(NUM_ANTENNAS);
+}
+
+template<int NUM_ANTENNAS>
+void PackedACM<NUM_ANTENNAS>::ToDense(const std::vector<int> &I, Eigen::MatrixXcf &dense) const
+{
+  const int n = I.size();
+  dense.resize(n, n);
+
+  // column k above the diagonal is the conjugate of row I[k], both walked front to back
+  for (int k = 0; k < n; k++)
+  {
+    const std::complex<float> *row = Row(I[k]);
+    std::complex<float> *dst = &dense(0, k);
+    for (int l = 0; l < k; l++)
+      dst[l] = std::conj(row[I[l]]);
+    dst[k] = row[I[k]];
+  }
+
+  // the lower triangle block by block, a block and its mirror stay in cache
+  const int B = 32;
+  for (int j0 = 0; j0 < n; j0 += B)
+    for (int i0 = j0; i0 < n; i0 += B)
+      for (int j = j0, je = std::min(j0 + B, n); j < je; j++)
+        for (int i = std::max(i0, j + 1), ie = std::min(i0 + B, n); i < ie; i++)
+          dense(i, j) = std::conj(dense(j, i));
+}
+
+template<int NUM_ANTENNAS>
+void PackedACM<NUM_ANTENNAS>::FromDense(const std::vector<int> &I, const Eigen::MatrixXcf &dense)
+{
+  const int n = I.size();
+  for (int k = 0; k < n; k++)
+  {
+    std::complex<float> *row = Row(I[k]);
+    for (int l = 0; l <= k; l++)
+      row[I[l]] = dense(k, l);
+  }
+}
+
+INSTANTIATE_ANTENNAS(PackedACM)
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <complex>
+#include <vector>
+
+/**
+ * Hermitian array covariance matrix stored as its lower triangle, in the
+ * baseline order of the correlator: (i, j) with j <= i at i*(i+1)/2 + j. Row
+ * i of the triangle is contiguous, the upper triangle is its conjugate.
+ */
+template<int NUM_ANTENNAS>
+class PackedACM
+{
+public:
+  PackedACM();
+
+  void SetZero();
+
+  /// Zeroes row and column i
+  void ZeroAntenna(const int i);
+
+  /// Replaces NaN values by zero and drops the imaginary part of the diagonal
+  void Sanitize();
+
+  /// The i+1 elements (i, 0) .. (i, i)
+  std::complex<float> *Row(const int i) { return mData.data() + std::size_t(i)*(i+1)/2; }
+  const std::complex<float> *Row(const int i) const { return mData.data() + std::size_t(i)*(i+1)/2; }
+
+  /// Element (i, j) of the full matrix
+  std::complex<float> operator()(const int i, const int j) const;
+
+  /// Absolute value of the mean of every column of the full matrix
+  void ColumnMeans(Eigen::VectorXf &means) const;
+
+  /**
+   * @brief
+   * Dense matrix of the antennas in I, in ascending order: dense(k, l) =
+   * (I[k], I[l]). Column k above the diagonal is read from the contiguous
+   * row I[k], the lower triangle is mirrored in cache sized blocks.
+   */
+  void ToDense(const std::vector<int> &I, Eigen::MatrixXcf &dense) const;
+
+  /// Stores the lower triangle of a dense Hermitian matrix of the antennas in I, in ascending order
+  void FromDense(const std::vector<int> &I, const Eigen::MatrixXcf &dense);
+
+  std::complex<float> *data() { return mData.data(); }
+  const std::complex<float> *data() const { return mData.data(); }
+  std::size_t size() const { return mData.size(); }
+
+private:
+  Eigen::VectorXcf mData;
+};
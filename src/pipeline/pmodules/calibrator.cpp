@@ -2,103 +2,155 @@
 #include <iomanip>
 #include <sstream>
 #include "calibrator.h"
+#include "../wsf_cost.h"
+#include "../subspace.h"
+#include "../khatri_rao.h"
+#include "../../config.h"
 
 #include "../../utils/antenna_positions.h"
 #include "../../utils/NMSMax.h"
+#include "../../utils/gauss_newton.h"
+#include "../../utils/ateam.h"
 
 #define MAX_MAJOR_CYCLES 10
 #define MAX_MINOR_CYCLES 30
 #define C_MS 299792458.0f
 
-std::string Calibrator::Name()
+DECLARE_bool(warm_start);
+DECLARE_string(position_solver);
+
+/// Longitude and latitude of a unit vector, as the solvers of wsfSrcPos see it
+static Vector2d Angles(const Vector3d &p)
+{
+  return Vector2d(atan2(p(1), p(0)), asin(p(2)));
+}
+
+static Vector3d Direction(const Vector2d &a)
+{
+  return Vector3d(cos(a(0)) * cos(a(1)), sin(a(0)) * cos(a(1)), sin(a(1)));
+}
+
+template<int NUM_ANTENNAS>
+std::string Calibrator<NUM_ANTENNAS>::Name()
 {
   std::stringstream ss;
   ss << "Calibrator: ";
   ss << std::setprecision(6) << std::fixed;
   for (int i = 0; i < mFluxes.size(); i++)
     ss << mFluxes(i) << " " << mRaSources(i) << " " << mDecSources(i) << " ";
+  ss << (mWarm ? "warm " : "cold ") << mMajorCycles << "/" << mFinalCycles << " " << mPositionCycles << " " << mSubspaceIterations;
   return ss.str();
 }
 
-void Calibrator::Initialize(DataBlob &blob)
+template<int NUM_ANTENNAS>
+void Calibrator<NUM_ANTENNAS>::Initialize(DataBlob<NUM_ANTENNAS> &blob)
 {
   (void) blob;
-  mAntennaLocalPosReshaped = ANT_ITRF();
+  mLayout = nullptr;
 
   mMask.resize(NUM_ANTENNAS, NUM_ANTENNAS);
-  mSpatialFilterMask.resize(NUM_ANTENNAS, NUM_ANTENNAS);
   mNoiseCovMatrix.resize(NUM_ANTENNAS, NUM_ANTENNAS);
 
   MatrixXd u = ANT_U(), v = ANT_V(), w = ANT_W();
   mUVDist = (u.array().square() + v.array().square() + w.array().square()).sqrt();
 
-  mRaSources.resize(5);
-  mDecSources.resize(5);
-  mFluxes.resize(5);
-
-  // Cassiopeia A (11000 flux)
-  mRaSources(0)   = 6.113786558863104;
-  mDecSources(0)  = 1.021919365863547;
-
-  // Cygnus A (8100 flux)
-  mRaSources(1)   = 5.226192095556169;
-  mDecSources(1)  = 0.7086036763096979;
-
-  // Tauras A (1420 flux)
-  mRaSources(2)   = 1.446441617590301;
-  mDecSources(2)  = 0.3835070143048873;
-
-  // Virgo A (970 flux)
-  mRaSources(3)   = 3.265074698168392;
-  mDecSources(3)  = 0.221104127406815;
-
-  mEpoch.resize(5);
-  mEpoch.setOnes();
-  mEpoch(4) = 0;
+  utils::ATeam(mRaSources, mDecSources, mEpoch);
+  mFluxes.resize(utils::NUM_ATEAM);
 
   mNormalizedData.resize(NUM_ANTENNAS, NUM_ANTENNAS);
   mMajorCycleResidue = mMinorCycleResidue = 0.0f;
+  mWarm = false;
+  mMajorCycles = mFinalCycles = mPositionCycles = mSubspaceIterations = 0;
+
+  if (FLAGS_position_solver == "gauss-newton")
+    mSolver = Solver::GAUSS_NEWTON;
+  else
+    mSolver = Solver::SIMPLEX;
+
+  if (mState == nullptr)
+  {
+    mOwnState.reset(new CalibratorState());
+    mState = mOwnState.get();
+  }
 }
 
-void Calibrator::Run(DataBlob &blob)
+template<int NUM_ANTENNAS>
+const typename Calibrator<NUM_ANTENNAS>::Layout &Calibrator<NUM_ANTENNAS>::Reshape(DataBlob<NUM_ANTENNAS> &blob, const double frequency)
 {
   static const double min_restriction = 10.0;                 ///< avoid vis. below this wavelength
   static const double max_restriction = 350.0;                ///< avoid vis. above this much meters
-  static const Vector3d normal(0.598753, 0.072099, 0.797682); ///< Normal to CS002 (central antenna)
 
+  // the flags of a subband and polarization rarely change between integrations
+  Layout &layout = mLayouts[2*blob.mHdr->subband + blob.mHdr->polarization];
+  if (layout.frequency == frequency && layout.flagged == blob.mHdr->flagged_dipoles && !layout.antennas.empty())
+    return layout;
+
+  layout.flagged = blob.mHdr->flagged_dipoles;
+  layout.frequency = frequency;
+  layout.antennas.clear();
+  for (int i = 0; i < NUM_ANTENNAS; i++)
+    if (!blob.mHdr->flagged_dipoles[i])
+      layout.antennas.push_back(i);
+
+  const std::vector<int> &I = layout.antennas;
+  const int n = I.size();
+  double uvdist_cutoff = std::min(min_restriction*(C_MS/frequency), max_restriction);
+  layout.positions.resize(n, 3);
+  layout.spatialFilterMask.resize(n, n);
+  for (int i = 0; i < n; i++)
+  {
+    layout.positions.row(i) = ANT_ITRF().row(I[i]);
+    for (int j = 0; j < n; j++)
+      layout.spatialFilterMask(i, j) = mUVDist(I[i], I[j]) < uvdist_cutoff ? 1.0f : 0.0f;
+  }
+
+  return layout;
+}
+
+template<int NUM_ANTENNAS>
+void Calibrator<NUM_ANTENNAS>::Run(DataBlob<NUM_ANTENNAS> &blob)
+{
   if (!blob.IsValid())
     return;
 
+  // the solution of key is ours until this integration is calibrated, one
+  // that arrives after a later integration of key neither uses nor replaces it
+  std::unique_lock<std::mutex> lock(mState->mutex);
+  Solution &shared = mState->solutions[2*blob.mHdr->subband + blob.mHdr->polarization];
+  mState->free.wait(lock, [&shared]{ return !shared.busy; });
+  shared.busy = true;
+  lock.unlock();
+
+  const double duration = blob.mHdr->end_time - blob.mHdr->start_time;
+  mStale = Solution();
+  Calibrate(blob, shared.end < blob.mHdr->start_time + 0.5*duration ? shared : mStale);
+
+  lock.lock();
+  shared.busy = false;
+  lock.unlock();
+  mState->free.notify_all();
+}
+
+template<int NUM_ANTENNAS>
+void Calibrator<NUM_ANTENNAS>::Calibrate(DataBlob<NUM_ANTENNAS> &blob, Solution &solution)
+{
+  static const Vector3d normal(0.598753, 0.072099, 0.797682); ///< Normal to CS002 (central antenna)
+
   mHasConverged = true;
   mFrequency = blob.CentralFrequency();
-  double uvdist_cutoff = std::min(min_restriction*(C_MS/mFrequency), max_restriction);
 
   // =====================================
   // ==== 0. Prepare/Reshape matrices ====
   // =====================================
-  int num_antennas = NUM_ANTENNAS - blob.mHdr->flagged_dipoles.count();
-  mNormalizedData.resize(num_antennas, num_antennas);
-  mSpatialFilterMask.resize(num_antennas, num_antennas);
-  mMask.resize(num_antennas, num_antennas);
+  mLayout = &Reshape(blob, mFrequency);
+  const std::vector<int> &I = mLayout->antennas;
+  int num_antennas = I.size();
+  mMask.setIdentity(num_antennas, num_antennas);
   mNoiseCovMatrix.resize(num_antennas, num_antennas);
-  mAntennaLocalPosReshaped.resize(num_antennas, 3);
   mGains.resize(num_antennas);
 
-  std::vector<int> I(num_antennas);
-  for (int i = 0, j = 0; i < NUM_ANTENNAS; i++)
-    if (!blob.mHdr->flagged_dipoles[i])
-      I[j++] = i;
-
-  for (int i = 0; i < num_antennas; i++)
-  {
-    mAntennaLocalPosReshaped.row(i) = ANT_ITRF().row(I[i]);
-    for (int j = 0; j < num_antennas; j++)
-    {
-      mNormalizedData(i, j) = blob.mACM(I[i], I[j]);
-      mSpatialFilterMask(i, j) = mUVDist(I[i], I[j]) < uvdist_cutoff ? 1.0f : 0.0f;
-      mMask(i, j) = blob.mMask(I[i], I[j]);
-    }
-  }
+  // only the solvers need the dense matrix, of the antennas that are not flagged
+  blob.mACM.ToDense(I, mNormalizedData);
 
   double time = blob.CentralTimeMJD() / 86400.0 + 2400000.5;
   utils::sunRaDec(time, mRaSources(4), mDecSources(4));
@@ -127,36 +179,89 @@ void Calibrator::Run(DataBlob &blob)
       j++;
     }
   }
-  statCal(mNormalizedData, mFrequency, mMask, mGains, mFluxes, mNoiseCovMatrix);
+
+  // seed with the previous solution unless the flags or the sky changed or it
+  // is not the integration right before this one, and start over when that
+  // does not converge
+  const double duration = blob.mHdr->end_time - blob.mHdr->start_time;
+  mWarm = FLAGS_warm_start && solution.valid && solution.flagged == blob.mHdr->flagged_dipoles && solution.sources == src_indices
+          && std::abs(solution.end - blob.mHdr->start_time) <= 0.5*duration;
+  if (mWarm)
+  {
+    statCal(mNormalizedData, mFrequency, mMask, solution.gains, solution.fluxes, mGains, mFluxes, mNoiseCovMatrix);
+    if (!mHasConverged)
+    {
+      mWarm = false;
+      mHasConverged = true;
+    }
+  }
+  if (!mWarm)
+    statCal(mNormalizedData, mFrequency, mMask, VectorXcf(), VectorXf(), mGains, mFluxes, mNoiseCovMatrix);
+
+  solution.valid = false;
   if (!mHasConverged)
     return;
 
+  if (!mWarm)
+  {
+    solution.flagged = blob.mHdr->flagged_dipoles;
+    solution.sources = src_indices;
+    solution.offsets.setZero(utils::NUM_ATEAM, 2);
+    solution.located.assign(utils::NUM_ATEAM, false);
+  }
+  solution.fluxes = mFluxes;
+
   // ====================================
   // ==== 3. WSF Position Estimation ====
   // ====================================
   MatrixXd selection((mFluxes.array() > mFluxes(0)*0.01).count(), 3);
   VectorXf fluxes(selection.rows());
+  std::vector<int> located;
   for (int i = 0, j = 0, n = mFluxes.rows(); i < n; i++)
   {
     if (mFluxes(i) > mFluxes(0)*0.01)
     {
       selection.row(j) = mSelection.row(i);
       fluxes(j) = mFluxes(i);
+      located.push_back(src_indices[i]);
       j++;
     }
     else
       blob.mHdr->ateam[src_indices[i]] = false;
   }
-  wsfSrcPos(mNormalizedData, mNoiseCovMatrix, mGains, mFrequency, selection);
+
+  // the sky turns between integrations, the offsets from the catalogue do not
+  MatrixXd catalogue = selection;
+  for (int j = 0; j < selection.rows(); j++)
+    if (solution.located[located[j]])
+      selection.row(j) = Direction(Angles(catalogue.row(j)) + solution.offsets.row(located[j]).transpose());
+
+  // the subspace only depends on the antennas, it seeds the next integration
+  // even when the sky changed or the gains started cold
+  if (!FLAGS_warm_start || solution.subspaceFlagged != blob.mHdr->flagged_dipoles
+      || std::abs(solution.subspaceEnd - blob.mHdr->start_time) > 0.5*duration)
+    solution.subspace.resize(0, 0);
+  wsfSrcPos(mNormalizedData, mNoiseCovMatrix, mGains, mFrequency, solution.subspace, selection);
+  solution.subspaceFlagged = blob.mHdr->flagged_dipoles;
+  solution.subspaceEnd = blob.mHdr->end_time;
+
+  for (int j = 0; j < selection.rows(); j++)
+  {
+    solution.offsets.row(located[j]) = (Angles(selection.row(j)) - Angles(catalogue.row(j))).transpose();
+    solution.located[located[j]] = true;
+  }
 
   // ==============================
   // ==== 4. Final calibration ====
   // ==============================
   std::complex<double> i1(0.0, 1.0);
   i1 *= 2.0 * M_PI * mFrequency / C_MS;
-  MatrixXcf A = (-i1 * (mAntennaLocalPosReshaped * selection.transpose())).array().exp().cast<std::complex<float>>();
+  MatrixXcf A = (-i1 * (mLayout->positions * selection.transpose())).array().exp().template cast<std::complex<float>>();
   MatrixXf inv_mask = (mNoiseCovMatrix.array().abs() > 0.0).select(MatrixXf::Zero(mNoiseCovMatrix.rows(), mNoiseCovMatrix.cols()), 1.0f);
-  walsCalibration(A, mNormalizedData, fluxes, inv_mask, mGains, mFluxes, mNoiseCovMatrix);
+  mFinalCycles = walsCalibration(A, mNormalizedData, fluxes, inv_mask, mWarm ? solution.gains : VectorXcf(), mGains, mFluxes, mNoiseCovMatrix);
+  solution.gains = mGains;
+  solution.end = blob.mHdr->end_time;
+  solution.valid = mHasConverged;
   mGains = (1.0/mGains.array());
   mGains.adjointInPlace();
   mNormalizedData = (mGains.transpose().adjoint() * mGains.transpose()).array() * (mNormalizedData.array() - mNoiseCovMatrix.array()).array();
@@ -178,43 +283,50 @@ void Calibrator::Run(DataBlob &blob)
     }
   }
 
-  // ================================================================
-  // ==== 6. Reconstruct the full ACM from the reshaped matrices ====
-  // ================================================================
-  for (int i = 0; i < num_antennas; i++)
-    for (int j = 0; j < num_antennas; j++)
-      blob.mACM(I[i], I[j]) = mNormalizedData(i, j);
+  // ===========================================================
+  // ==== 6. Reconstruct the ACM from the reshaped matrices ====
+  // ===========================================================
+  blob.mACM.FromDense(I, mNormalizedData);
 }
 
-void Calibrator::statCal(const MatrixXcf &inData,
+template<int NUM_ANTENNAS>
+void Calibrator<NUM_ANTENNAS>::statCal(const MatrixXcf &inData,
                          const double inFrequency,
                          MatrixXf &ioMask,
+                         const VectorXcf &inInitialGains,
+                         const VectorXf &inInitialFluxes,
                          VectorXcf &outCalibrations,
                          VectorXf &outSigmas,
                          MatrixXcf &outVisibilities)
 {
   std::complex<double> i1(0.0, 1.0);
   i1 *= 2.0 * M_PI * inFrequency / C_MS;
-  MatrixXcf A = (-i1 * (mAntennaLocalPosReshaped * mSelection.transpose())).array().exp().cast<std::complex<float>>();
+  MatrixXcf A = (-i1 * (mLayout->positions * mSelection.transpose())).array().exp().template cast<std::complex<float>>();
 
-  MatrixXcf KA(A.rows()*A.rows(), A.cols());
-  utils::khatrirao<std::complex<float>>(A.conjugate(), A, KA);
+  MatrixXf mask = 1.0f - (ioMask.array() > mLayout->spatialFilterMask.array()).select(ioMask, mLayout->spatialFilterMask).array();
 
-  MatrixXf AA = (A.adjoint() * A).array().abs().square();
+  // a warm start skips the least squares estimate of the apparent fluxes
+  VectorXf flux = inInitialFluxes;
+  if (flux.size() != A.cols())
+  {
+    MatrixXf AA = (A.adjoint() * A).array().abs().square();
 
-  MatrixXf mask = 1.0f - (ioMask.array() > mSpatialFilterMask.array()).select(ioMask, mSpatialFilterMask).array();
-  MatrixXcf data = inData.array() * mask.array();
-  data.resize(inData.rows()*inData.cols(), 1);
-  VectorXf flux = (AA.inverse() * KA.adjoint() * data).array().real();
-  mMajorCycles = walsCalibration(A, inData, flux, mask, outCalibrations, outSigmas, outVisibilities);
+    MatrixXcf data = inData.array() * mask.array();
+    VectorXcf projection;
+    khatri_rao::Project(A, data, projection);
+    flux = (AA.inverse() * projection).array().real();
+  }
+  mMajorCycles = walsCalibration(A, inData, flux, mask, inInitialGains, outCalibrations, outSigmas, outVisibilities);
   outCalibrations = (1.0f/outCalibrations.array()).conjugate();
 }
 
 
-int Calibrator::walsCalibration(const MatrixXcf &inModel,  					// A
+template<int NUM_ANTENNAS>
+int Calibrator<NUM_ANTENNAS>::walsCalibration(const MatrixXcf &inModel,  					// A
                                 const MatrixXcf &inData,   					// Rhat
                                 const VectorXf  &inFluxes, 					// sigmas
                                 const MatrixXf  &inInvMask,         // mask
+                                const VectorXcf &inInitialGains,    // g of a previous solution, empty for a cold start
                                 VectorXcf &outGains,          // g
                                 VectorXf  &outSourcePowers,   // sigmas
                                 MatrixXcf &outNoiseCovMatrix) // Sigma_n
@@ -224,14 +336,22 @@ int Calibrator::walsCalibration(const MatrixXcf &inModel,  					// A
   outNoiseCovMatrix.setZero();
   VectorXcf cur_gains(inData.rows());
   VectorXcf prev_gains(inData.rows());
-  for (int i = 0; i < inData.rows(); i++)
-    prev_gains(i) = std::complex<float>(0.0f, 1.0f);
+  if (inInitialGains.size() == inData.rows())
+    prev_gains = inInitialGains;
+  else
+    for (int i = 0; i < inData.rows(); i++)
+      prev_gains(i) = std::complex<float>(0.0f, 1.0f);
   VectorXf cur_fluxes(inFluxes.rows());
   VectorXf prev_fluxes(inFluxes);
 
-  int n = (inInvMask.array() > 0.5f).count();
-  MatrixXcf rest(n, inFluxes.size());
-  MatrixXcf data(n, 1);
+  // the flux normal equations are formed from A^H R A and A^H A, the few
+  // masked visibilities are corrected for from a list
+  const std::vector<int> excluded = khatri_rao::Excluded(inInvMask);
+  const MatrixXcf data = inData.array() * inInvMask.array();
+  MatrixXcf M(inData.rows(), inData.cols());
+  MatrixXcf GA(inModel.rows(), inModel.cols());
+  MatrixXcf gram;
+  VectorXcf projection;
   MatrixXcf pinv(inFluxes.size(), inFluxes.size());
   int i;
   for (i = 1; i <= MAX_MAJOR_CYCLES; i++)
@@ -239,8 +359,9 @@ int Calibrator::walsCalibration(const MatrixXcf &inModel,  					// A
     // ======================================================
     // ==== 1. Per sensor gain estimation using gainSolv ====
     // ======================================================
-    MatrixXcf M = inModel * prev_fluxes.asDiagonal() * inModel.adjoint();
-    gainSolv(M.array() * inInvMask.array(), inData.array() * inInvMask.array(), prev_gains, cur_gains);
+    M.noalias() = inModel * prev_fluxes.asDiagonal() * inModel.adjoint();
+    M.array() *= inInvMask.array().template cast<std::complex<float>>();
+    gainSolv(M, data, prev_gains, cur_gains);
 
     float avg_gain = (cur_gains.array().abs()).mean();
     cur_gains.array() /= avg_gain;
@@ -249,31 +370,26 @@ int Calibrator::walsCalibration(const MatrixXcf &inModel,  					// A
     // =========================================
     // ==== 2. Model source flux estimation ====
     // =========================================
-    MatrixXcf GA = cur_gains.asDiagonal() * inModel;
-    M.resize(GA.rows()*GA.rows(), GA.cols());
-    utils::khatrirao<std::complex<float> >(GA.conjugate(), GA, M);
-
-    // Filter out masked data
-    int j = 0, k = 0;
-    while (j < inInvMask.size())
-    {
-      if (inInvMask(j) > 0.5f)
-      {
-        rest.row(k) = M.row(j);
-        data(k) = inData(j);
-        k++;
-      }
-      j++;
-    }
-    utils::pseudoInverse<std::complex<float> >(rest.adjoint()*rest, pinv);
-    cur_fluxes = (pinv * rest.adjoint() * data).real();
+    GA.noalias() = cur_gains.asDiagonal() * inModel;
+    khatri_rao::Gram(GA, excluded, gram);
+    khatri_rao::Project(GA, data, projection);
+    utils::pseudoInverse<std::complex<float> >(gram, pinv);
+    cur_fluxes = (pinv * projection).real();
     if ((cur_fluxes.array() == INFINITY).any())
       cur_fluxes = prev_fluxes;
 
     // ========================================
     // ==== 3. Noise covariance estimation ====
     // ========================================
-    outNoiseCovMatrix = (inData - GA * cur_fluxes.asDiagonal() * GA.adjoint()).array() * (1.0f - inInvMask.array());
+    outNoiseCovMatrix.setZero();
+    for (auto e : excluded)
+    {
+      const int p = e % inData.rows(), q = e / inData.rows();
+      std::complex<float> model = 0.0f;
+      for (int k = 0; k < GA.cols(); k++)
+        model += GA(p,k) * cur_fluxes(k) * std::conj(GA(q,k));
+      outNoiseCovMatrix(e) = inData(e) - model;
+    }
 
     // =================================
     // ==== 4. Test for convergence ====
@@ -321,73 +437,29 @@ int Calibrator::walsCalibration(const MatrixXcf &inModel,  					// A
   return i;
 }
 
-int Calibrator::gainSolv(const MatrixXcf &inModel,
+template<int NUM_ANTENNAS>
+int Calibrator<NUM_ANTENNAS>::gainSolv(const MatrixXcf &inModel,
                          const MatrixXcf &inData,
                          const VectorXcf &inEstimatedGains,
                          VectorXcf &outGains)
 {
-  int n = inModel.rows();
-
-  // allocate once
-  MatrixXcf data_normalised(n, n);
-  MatrixXcf data_calibrated(n, n);
-  VectorXcf estimated_calibration(n);
-  VectorXcf tmp(n);
-
   static const float epsilon = 1e-6f;
 
-  for (int i = 0; i < n; i++)
-  {
-    // Normalize the data
-    data_normalised.col(i) = inData.col(i) / inData.col(i).dot(inData.col(i));
-
-    // Initial calibration
-    data_calibrated.col(i) = inEstimatedGains.array() * inModel.col(i).array();
-  }
-
-  int i;
-  for (i = 1; i <= MAX_MINOR_CYCLES; i++)
-  {
-    for (int j = 0; j < n; j++)
-    {
-      estimated_calibration(j) = data_normalised.col(j).dot(data_calibrated.col(j));
-      outGains(j) = 1.0f / std::conj(estimated_calibration(j));
-    }
+  // one polarization of one subband per blob, so a batch of one
+  std::vector<GainSolver::Problem> batch(1, GainSolver::Problem(inModel, inData, inEstimatedGains));
+  mGainSolver.Solve(batch, MAX_MINOR_CYCLES, epsilon);
 
-    if (i % 2 == 1)
-      tmp = outGains;
-    else
-    {
-      // Update gains and check for convergence
-      estimated_calibration = outGains;
-      outGains = (outGains.array() + tmp.array()) / 2.0f;
-      float gains_normal = outGains.norm();
-      tmp = outGains.array() - estimated_calibration.array();
-      float delta_gains_normal = tmp.norm();
-      mMinorCycleResidue = delta_gains_normal / gains_normal;
-      if (mMinorCycleResidue <= epsilon)
-      {
-//        qDebug("[%s] Convergence after %d iterations", __FUNCTION__, i);
-        break;
-      }
-    }
-
-    // Update calibration of array covariance matrix
-    for (int j = 0; j < n; j++)
-      data_calibrated.col(j) = outGains.array() * inModel.col(j).array();
-  }
-
-//  if (i >= MAX_MINOR_CYCLES)
-//    qCritical("[%s] No convergence after %d iterations", __FUNCTION__, i);
-
-  return i;
+  outGains = batch[0].gains;
+  mMinorCycleResidue = batch[0].residue;
+  return batch[0].cycles;
 }
 
-
-void Calibrator::wsfSrcPos(const MatrixXcf &inData,
+template<int NUM_ANTENNAS>
+void Calibrator<NUM_ANTENNAS>::wsfSrcPos(const MatrixXcf &inData,
                            const MatrixXcf &inSigma1,
                            const VectorXcf &inGains,
                            const double inFreq,
+                           MatrixXcf &ioSubspace,
                            MatrixXd &ioPositions)
 {
   int nsrc = ioPositions.rows();
@@ -398,63 +470,50 @@ void Calibrator::wsfSrcPos(const MatrixXcf &inData,
     init(i + nsrc) = asin(ioPositions(i, 2));
   }
 
-  SelfAdjointEigenSolver<MatrixXcf> solver(inData);
+  // only the signal subspace is needed, iterated from the one of the
+  // previous integration with a full decomposition when that fails
+  VectorXf eigenvalues_abs;
+  MatrixXcf Es;
+  mSubspaceIterations = subspace::Dominant(inData, nsrc, ioSubspace, eigenvalues_abs);
+  if (mSubspaceIterations > 0)
+    Es = ioSubspace.leftCols(nsrc);
+  else
+  {
+    SelfAdjointEigenSolver<MatrixXcf> solver(inData);
 
-  VectorXf eigenvalues_abs = solver.eigenvalues().array().abs();
-  VectorXi I = NM::sort(eigenvalues_abs);
+    eigenvalues_abs = solver.eigenvalues().array().abs();
+    VectorXi I = NM::sort(eigenvalues_abs);
+
+    ioSubspace.resize(inData.rows(), ioSubspace.cols());
+    for (int i = 0; i < ioSubspace.cols(); i++)
+      ioSubspace.col(i) = solver.eigenvectors().col(I(i));
+    Es = ioSubspace.leftCols(nsrc);
+  }
 
-  MatrixXcf Es(solver.eigenvectors().rows(), nsrc);
   MatrixXf eigenmat_abs(nsrc, nsrc);
   eigenmat_abs.setZero();
   for (int i = 0; i < nsrc; i++)
-  {
     eigenmat_abs(i,i) = eigenvalues_abs(i);
-    Es.col(i) = solver.eigenvectors().col(I(i));
-  }
 
   MatrixXf eye = MatrixXf::Identity(nsrc, nsrc);
   MatrixXf S = inSigma1.diagonal().array().real();
   MatrixXf A = (eigenmat_abs.array() - (S.mean() * eye).array());
   MatrixXf W = (A * A).array() / eigenmat_abs.array();
   W = (W.array() != W.array()).select(0,W);
-  MatrixXcf EsWEs = Es * W * Es.adjoint();
-  MatrixXcf T = 1.0f / inGains.array();
-  MatrixXcf G = T.conjugate().asDiagonal().toDenseMatrix();
+  VectorXf w = W.diagonal();
+  VectorXcf g = (1.0f / inGains.array()).conjugate();
 
-  WSFCost wsf_cost(EsWEs, G, inFreq, mAntennaLocalPosReshaped, nsrc);
+  // Es W Es^H is only used in factored form
+  WSFCost wsf_cost(Es, w, g, inFreq, mLayout->positions);
 
-  init = NM::Simplex(wsf_cost, init, mSimplexCycles, 1e-3, 1000);
+  if (mSolver == Solver::GAUSS_NEWTON)
+    init = NLS::GaussNewton(wsf_cost, init, mPositionCycles, 1e-3, 1000);
+  else
+    init = NM::Simplex(wsf_cost, init, mPositionCycles, 1e-3, 1000);
 
   ioPositions.col(0) = init.head(nsrc).array().cos() * init.tail(nsrc).array().cos();
   ioPositions.col(1) = init.head(nsrc).array().sin() * init.tail(nsrc).array().cos();
   ioPositions.col(2) = init.tail(nsrc).array().sin();
 }
 
-Calibrator::WSFCost::WSFCost(const MatrixXcf &inW, const MatrixXcf &inG, const double inFreq, const MatrixXd &inP, const int n):
-  W(inW),
-  G(inG),
-  P(inP),
-  freq(inFreq),
-  nsrc(n),
-  i1(0.0, 1.0)
-{
-  i1 *= 2.0 * M_PI * freq / C_MS;
-  T.resize(P.rows(), nsrc);
-  A.resize(G.rows(), nsrc);
-  src_pos.resize(nsrc, 3);
-  PAperp.resize(P.rows(), P.rows());
-  Eye = MatrixXcf::Identity(P.rows(), P.rows());
-}
-
-float Calibrator::WSFCost::operator()(const VectorXd &theta)
-{
-  src_pos.col(0) = theta.head(nsrc).array().cos() * theta.tail(nsrc).array().cos();
-  src_pos.col(1) = theta.head(nsrc).array().sin() * theta.tail(nsrc).array().cos();
-  src_pos.col(2) = theta.tail(nsrc).array().sin();
-
-  T = (-i1 * (P * src_pos.transpose())).array().exp().cast<std::complex<float> >();
-  A = G * T;
-  PAperp = Eye.array() - (A * (A.adjoint() * A).lu().solve(A.adjoint())).array();
-
-  return (PAperp * W).trace().real();
-}
+INSTANTIATE_ANTENNAS(Calibrator)
@@ -3,24 +3,84 @@
 #include <pipeline/processing_module_interface.h>
 #include <Eigen/Dense>
 #include <bitset>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
 
 #include "../datablob.h"
+#include "../gain_solver.h"
 
 using namespace Eigen;
 
-class Calibrator : public ProcessingModuleInterface<DataBlob>
+/**
+ * What the Calibrators of all processing threads share, so an integration
+ * is seeded with the solution of the one before it whichever thread
+ * calibrated that.
+ */
+struct CalibratorState
+{
+  /// Solution of the last integration of a subband and polarization, seeds the next one
+  struct Solution
+  {
+    Solution(): subspaceEnd(0.0), end(0.0), valid(false), busy(false) {}
+
+    std::bitset<576> flagged;
+    std::vector<int> sources; ///< a-team sources above the horizon
+    VectorXcf gains;          ///< gains of the final calibration, before they are inverted
+    VectorXf fluxes;          ///< fluxes of the initial calibration
+    MatrixXd offsets;         ///< located minus catalogue longitude and latitude of each a-team source
+    MatrixXcf subspace;       ///< dominant eigenvectors of the whitened acm of the integration ending at subspaceEnd
+    std::bitset<576> subspaceFlagged;
+    double subspaceEnd;
+    std::vector<bool> located;
+    double end;               ///< end time of the integration it solves, seeds only the one starting then
+    bool valid;
+    bool busy;                ///< an integration of this subband and polarization is being calibrated
+  };
+
+  std::mutex mutex;
+  std::condition_variable free; ///< signalled when a solution is no longer busy
+  std::map<int, Solution> solutions;
+};
+
+template<int NUM_ANTENNAS>
+class Calibrator : public ProcessingModuleInterface<DataBlob<NUM_ANTENNAS>>
 {
 public:
-  Calibrator() {}
+  /// A Calibrator with state of its own, created on Initialize
+  Calibrator(): mState(nullptr) {}
+  /// A Calibrator sharing state with the Calibrators of the other processing threads
+  explicit Calibrator(CalibratorState &state): mState(&state) {}
 
   virtual std::string Name();
-  virtual void Initialize(DataBlob &blob);
-  virtual void Run(DataBlob &blob);
+  virtual void Initialize(DataBlob<NUM_ANTENNAS> &blob);
+  virtual void Run(DataBlob<NUM_ANTENNAS> &blob);
 
 private:
+  /// How wsfSrcPos minimizes the WSF cost, see --position_solver
+  enum class Solver { SIMPLEX, GAUSS_NEWTON };
+
+  /// The unflagged antennas of an integration and what only depends on them and the frequency
+  struct Layout
+  {
+    std::bitset<576> flagged;
+    double frequency;
+    std::vector<int> antennas;  ///< indices of the unflagged antennas
+    MatrixXd positions;         ///< itrf positions of the unflagged antennas
+    MatrixXf spatialFilterMask; ///< baselines shorter than the uv cutoff
+  };
+
+  typedef CalibratorState::Solution Solution;
+
+  void Calibrate(DataBlob<NUM_ANTENNAS> &blob, Solution &solution);
+  const Layout &Reshape(DataBlob<NUM_ANTENNAS> &blob, const double frequency);
+
   void statCal(const MatrixXcf &inData,
                const double inFrequency,
                MatrixXf &ioMask,
+               const VectorXcf &inInitialGains,
+               const VectorXf &inInitialFluxes,
                VectorXcf &outCalibrations,
                VectorXf &outSigmas,
                MatrixXcf &outVisibilities);
@@ -34,6 +94,7 @@ private:
                       const MatrixXcf &inData,
                       const VectorXf  &inFluxes,
                       const MatrixXf  &inInvMask,
+                      const VectorXcf &inInitialGains,
                       VectorXcf &outGains,
                       VectorXf  &outSourcePowers,
                       MatrixXcf &outNoiseCovMatrix);
@@ -42,40 +103,24 @@ private:
                  const MatrixXcf &inSigma1,
                  const VectorXcf &inGains,
                  const double inFreq,
+                 MatrixXcf &ioSubspace,
                  MatrixXd &ioPositions);
 
-  class WSFCost
-  {
-  public:
-    WSFCost(const MatrixXcf &inW, const MatrixXcf &inG, const double inFreq, const MatrixXd &inP, const int n);
-
-    float operator()(const VectorXd &theta);
-
-  private:
-    const MatrixXcf &W;
-    const MatrixXcf &G;
-    const MatrixXd &P;
-    const double freq;
-    const int nsrc;
-
-    MatrixXd src_pos;
-    MatrixXcf T;
-    MatrixXcf A;
-    MatrixXcf Eye;
-    MatrixXcf PAperp;
-    std::complex<double> i1;
-  };
-
   /// Initialized in the constructor and const
   MatrixXd mUVDist;
   VectorXd mRaSources;
   VectorXd mDecSources;
   VectorXi mEpoch;
 
-  /// Changed when new antenna are (un)flagged
-  std::vector<int> mFlagged;
-  MatrixXf mSpatialFilterMask;
-  MatrixXd mAntennaLocalPosReshaped;
+  /// Changed when new antenna are (un)flagged, one per subband and polarization
+  std::map<int, Layout> mLayouts;
+  const Layout *mLayout;
+  CalibratorState *mState;
+  std::unique_ptr<CalibratorState> mOwnState;
+  Solution mStale;          ///< stands in for the shared solution of an integration older than it
+  bool mWarm;
+  Solver mSolver;
+  GainSolver mGainSolver;
   MatrixXf mMask;
   MatrixXd mSelection;
   MatrixXcf mNormalizedData;
@@ -88,7 +133,9 @@ private:
   float mMinorCycleResidue;
   bool mHasConverged;
   int mMajorCycles;
-  int mSimplexCycles;
+  int mFinalCycles;
+  int mPositionCycles;
+  int mSubspaceIterations;
 };
 
 
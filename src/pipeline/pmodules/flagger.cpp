@@ -1,6 +1,7 @@
 #include "flagger.h"
 #include "../../config.h"
 #include "../datablob.h"
+#include "../reduction.h"
 #include "../../utils/sigmaclip.h"
 
 #include <glog/logging.h>
@@ -9,90 +10,177 @@
 
 DECLARE_double(antsigma);
 DECLARE_double(vissigma);
+DECLARE_double(rfisigma);
+DECLARE_int32(rfiwindow);
+DECLARE_string(rfi_affinity);
+DECLARE_string(flagged_dipoles);
+DECLARE_string(antenna_power);
+
+/// Antennas known to be bad, see --flagged_dipoles
+static std::vector<int> FlaggedDipoles()
+{
+  std::vector<int> dead;
+  if (!FLAGS_flagged_dipoles.empty())
+    dead = utils::ParseAffinity(FLAGS_flagged_dipoles);
+  return dead;
+}
 
-std::string Flagger::Name()
+template<int NUM_ANTENNAS>
+FlaggerState<NUM_ANTENNAS>::FlaggerState():
+  health(FlaggedDipoles(), FLAGS_antsigma)
+{
+  if (FLAGS_rfisigma > 0.0)
+  {
+    std::vector<int> affinity;
+    if (!FLAGS_rfi_affinity.empty())
+      affinity = utils::ParseAffinity(FLAGS_rfi_affinity);
+    rfi.reset(new RFIFlagger<NUM_ANTENNAS>(FLAGS_rfisigma, FLAGS_rfiwindow, affinity));
+  }
+}
+
+template<int NUM_ANTENNAS>
+std::string Flagger<NUM_ANTENNAS>::Name()
 {
   std::stringstream ss;
   ss << "Flagger: ";
   ss << mBlob->mHdr->flagged_dipoles.count();
   ss << " " << mBlob->mHdr->flagged_channels.count();
+  ss << " " << mFlaggedVis;
+  if (mPower == Power::COMPARE)
+    ss << " " << mOnlyACM << "/" << mOnlyAuto;
   return ss.str();
 }
 
-void Flagger::Initialize(DataBlob &blob)
+template<int NUM_ANTENNAS>
+void Flagger<NUM_ANTENNAS>::Initialize(DataBlob<NUM_ANTENNAS> &blob)
 {
   (void) blob;
   mAntennas.resize(NUM_ANTENNAS);
+  mSums.resize(NUM_CHANNELS);
   mAntSigma = FLAGS_antsigma;
   mVisSigma = FLAGS_vissigma;
+  mFlaggedVis = 0;
+  mOnlyACM = 0;
+  mOnlyAuto = 0;
+  mAutoPowers.resize(NUM_ANTENNAS);
+  mSkip.resize(NUM_ANTENNAS);
+
+  if (FLAGS_antenna_power == "auto")
+    mPower = Power::AUTO;
+  else if (FLAGS_antenna_power == "compare")
+    mPower = Power::COMPARE;
+  else
+    mPower = Power::ACM;
+
+  if (mState == nullptr)
+  {
+    mOwnState.reset(new FlaggerState<NUM_ANTENNAS>());
+    mState = mOwnState.get();
+  }
+  mFlags.resize(Config<NUM_ANTENNAS>::NUM_BASELINES);
+
+}
+
+template<int NUM_ANTENNAS>
+void Flagger<NUM_ANTENNAS>::FlagAntennas(const int key)
+{
+  mAntMask = (mAntennas.array() < 1e-5f).select(Eigen::VectorXf::Zero(NUM_ANTENNAS), Eigen::VectorXf::Ones(NUM_ANTENNAS));
+
+  // Skip acm's that are all 0, and clipping while the antennas behave as before
+  if (mAntMask.sum() > 0.5f)
+  {
+    if (!mState->health.Expected(key, mAntennas, mAntMask))
+      utils::SigmaClip(mAntennas, mAntMask, mScratch, mAntSigma);
+    mState->health.Update(key, mAntennas, mAntMask);
+  }
 }
 
-void Flagger::Run(DataBlob &b)
+template<int NUM_ANTENNAS>
+void Flagger<NUM_ANTENNAS>::Run(DataBlob<NUM_ANTENNAS> &b)
 {
   mBlob = &b;
   using namespace std;
 
-  const int N = NUM_BASELINES;
-  const int M = NUM_CHANNELS;
+  const int N = Config<NUM_ANTENNAS>::NUM_BASELINES;
 
-  mVisMask = Eigen::MatrixXf::Zero(M, N);
+  // channels excluded at ingest are flagged and not present in the datum
+  mSelected.clear();
+  for (int i = 0; i < NUM_CHANNELS; i++)
+    if (!b.mHdr->flagged_channels[i+1])
+      mSelected.push_back(i);
+  const int M = mSelected.size();
 
-  // map raw data to complex eigen matrix
-  Eigen::Map<Eigen::MatrixXcf, Eigen::Aligned>
-    raw(reinterpret_cast<std::complex<float>*>(b.mDatum->data()+sizeof(output_header_t)),
-         NUM_CHANNELS,
-         NUM_BASELINES);
+  std::complex<float> *raw = reinterpret_cast<std::complex<float>*>(b.mDatum->data()+sizeof(output_header_t));
 
-  // collapse to channel vector
-  mChannels = raw.rowwise().mean().array().abs();
-  mChannelMask = Eigen::VectorXf::Ones(M);
-  utils::SigmaClip(mChannels, mChannelMask, mVisSigma);
+  // antennas known to be bad are left out of everything that follows
+  const int key = 2*b.mHdr->subband + b.mHdr->polarization;
+  mState->health.Skip(key, mKnown);
+  const uint8_t *skip = mKnown.data();
 
-  // mask rows that contribute
-  for (int i = 0; i < M; i++)
+  // screen the antennas on their autocorrelations, before any work per baseline
+  if (mPower != Power::ACM)
+    reduction::AutoPowers(raw, NUM_ANTENNAS, M, b.mWeights.data(), skip, mAutoPowers.data());
+
+  if (mPower == Power::AUTO)
   {
-    if (mChannelMask(i))
-      mVisMask.row(i).setOnes();
-    else
-      b.mHdr->flagged_channels[i+1] = true;
+    mAntennas = mAutoPowers;
+    FlagAntennas(key);
+    for (int i = 0; i < NUM_ANTENNAS; i++)
+      mSkip[i] = skip[i] || !mAntMask(i);
+    skip = mSkip.data();
   }
 
-  // apply clip mask to data
-  raw.array() *= mVisMask.array();
+  // zero visibilities with narrow band rfi before anything is averaged
+  const uint64_t *flags = nullptr;
+  if (mState->rfi)
+  {
+    mFlaggedVis = mState->rfi->Run(raw, M, key, b.mHdr->start_time, b.mHdr->end_time, mFlags.data(), skip);
+    flags = mFlags.data();
+  }
 
-  // compute mean such that we ignore clipped data, this is our final result
-  mResult = raw.colwise().sum().array() / mVisMask.colwise().sum().array();
+  // collapse to channel vector
+  reduction::ChannelSums(raw, NUM_ANTENNAS, M, b.mWeights.data(), skip, mSums.data());
+  mChannels = (mSums.head(M).array() / double(N)).abs().cast<float>();
+  mChannelMask = Eigen::VectorXf::Ones(M);
+  utils::SigmaClip(mChannels, mChannelMask, mScratch, mVisSigma);
 
-  // construct acm from result
-  for (int i = 0, s = 0; i < NUM_ANTENNAS; i++)
+  for (int i = 0; i < M; i++)
+    if (!mChannelMask(i))
+      b.mHdr->flagged_channels[mSelected[i]+1] = true;
+
+  // compute mean such that we ignore clipped data, this is our final result,
+  // in baseline order it is the packed acm and the rows of skipped antennas are zero
+  reduction::MaskedMeans(raw, NUM_ANTENNAS, M, b.mWeights.data(), skip, mChannelMask.data(), flags, b.mACM.data());
+  b.mACM.Sanitize();
+
+  if (mPower != Power::AUTO)
   {
-    b.mACM.col(i).head(i + 1) = mResult.segment(s, i + 1).conjugate();
-    b.mACM.row(i).head(i + 1) = mResult.segment(s, i + 1);
-    b.mACM(i,i) = std::complex<float>(b.mACM(i,i).real(), 0.0f);
-    s += i + 1;
+    // Compute antenna power
+    b.mACM.ColumnMeans(mAntennas);
+    FlagAntennas(key);
   }
 
-  // clear NaN values
-  b.mACM = (b.mACM.array() != b.mACM.array()).select(complex<float>(0.0f, 0.0f), b.mACM);
-
-  // Compute antenna power
-  mAntennas = b.mACM.colwise().mean().array().abs();
-  mAntMask = (mAntennas.array() < 1e-5f).select(Eigen::VectorXf::Zero(NUM_ANTENNAS), Eigen::VectorXf::Ones(NUM_ANTENNAS));
+  if (mPower == Power::COMPARE)
+  {
+    mAutoMask = (mAutoPowers.array() < 1e-5f).select(Eigen::VectorXf::Zero(NUM_ANTENNAS), Eigen::VectorXf::Ones(NUM_ANTENNAS));
+    if (mAutoMask.sum() > 0.5f)
+      utils::SigmaClip(mAutoPowers, mAutoMask, mScratch, mAntSigma);
 
-  // Skip acm's that are all 0
-  if (mAntMask.sum() > 0.5f)
-    utils::SigmaClip(mAntennas, mAntMask, mAntSigma);
+    mOnlyACM = ((mAntMask.array() == 0.0f) && (mAutoMask.array() != 0.0f)).count();
+    mOnlyAuto = ((mAntMask.array() != 0.0f) && (mAutoMask.array() == 0.0f)).count();
+  }
 
-  // Now we can determine bad antennas
+  // Now we can determine bad antennas, in auto mode their rows are zero already
   for (int i = 0; i < NUM_ANTENNAS; i++)
   {
-    if (mAntMask(i))
+    if (mAntMask(i) && !skip[i])
       continue;
 
     b.mHdr->flagged_dipoles[i] = true;
-    b.mMask.col(i).setOnes();
-    b.mMask.row(i).setOnes();
-    b.mACM.col(i).setZero();
-    b.mACM.row(i).setZero();
+    if (mPower != Power::AUTO)
+      b.mACM.ZeroAntenna(i);
   }
 }
+
+INSTANTIATE_ANTENNAS(FlaggerState)
+INSTANTIATE_ANTENNAS(Flagger)
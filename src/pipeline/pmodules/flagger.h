@@ -2,26 +2,65 @@
 
 #include <pipeline/processing_module_interface.h>
 #include <Eigen/Dense>
+#include <memory>
 
 #include "../datablob.h"
+#include "../rfi_flagger.h"
+#include "../antenna_health.h"
 
-class Flagger : public ProcessingModuleInterface<DataBlob>
+/**
+ * What the Flaggers of all processing threads share, so the rfi history and
+ * the antenna health of a subband and polarization see every integration
+ * whichever thread flags it.
+ * Configured from the command line flags.
+ */
+template<int NUM_ANTENNAS>
+struct FlaggerState
+{
+  FlaggerState();
+
+  std::unique_ptr<RFIFlagger<NUM_ANTENNAS>> rfi; ///< null when --rfisigma is 0
+  AntennaHealth<NUM_ANTENNAS> health;
+};
+
+template<int NUM_ANTENNAS>
+class Flagger : public ProcessingModuleInterface<DataBlob<NUM_ANTENNAS>>
 {
 public:
-  Flagger(){}
+  /// A Flagger with state of its own, created on Initialize
+  Flagger(): mState(nullptr) {}
+  /// A Flagger sharing state with the Flaggers of the other processing threads
+  explicit Flagger(FlaggerState<NUM_ANTENNAS> &state): mState(&state) {}
 
   virtual std::string Name();
-  virtual void Initialize(DataBlob &blob);
-  virtual void Run(DataBlob &blob);
+  virtual void Initialize(DataBlob<NUM_ANTENNAS> &blob);
+  virtual void Run(DataBlob<NUM_ANTENNAS> &blob);
 
 private:
-  DataBlob *mBlob;
+  /// Where the antenna powers come from, see --antenna_power
+  enum class Power { ACM, AUTO, COMPARE };
+
+  void FlagAntennas(const int key);
+
+  DataBlob<NUM_ANTENNAS> *mBlob;
+  Power mPower;
   float mAntSigma;
   float mVisSigma;
+  int mFlaggedVis;
+  int mOnlyACM;
+  int mOnlyAuto;
+  FlaggerState<NUM_ANTENNAS> *mState;
+  std::unique_ptr<FlaggerState<NUM_ANTENNAS>> mOwnState;
+  std::vector<uint64_t> mFlags;
+  std::vector<int> mSelected;
+  Eigen::VectorXcd mSums;
   Eigen::VectorXf mChannels;
   Eigen::VectorXf mChannelMask;
   Eigen::VectorXf mAntMask;
-  Eigen::MatrixXf mVisMask;
   Eigen::VectorXf mAntennas;
-  Eigen::VectorXcf mResult;
+  Eigen::VectorXf mAutoPowers;
+  Eigen::VectorXf mAutoMask;
+  std::vector<uint8_t> mKnown;
+  std::vector<uint8_t> mSkip;
+  Eigen::VectorXf mScratch;
 };
@@ -3,9 +3,8 @@
 #include "weighter.h"
 #include "../../config.h"
 
-int32_t index();
-
-std::string Weighter::Name()
+template<int NUM_ANTENNAS>
+std::string Weighter<NUM_ANTENNAS>::Name()
 {
   std::stringstream ss;
   ss << "Weighter: ";
@@ -14,24 +13,24 @@ std::string Weighter::Name()
   else
   {
     ss.precision(2);
-    constexpr int n = NUM_ANTENNAS == 288 ? (6*7/2) : (12*13/2);
-    for (int i = 0; i < n; i++)
+    for (int i = 0; i < Config<NUM_ANTENNAS>::NUM_WEIGHTS; i++)
       ss << std::fixed << mBlob->mHdr->weights[i]/float(mMaxNum) << " ";
   }
 
   return ss.str();
 }
 
-void Weighter::Initialize(DataBlob &blob)
+template<int NUM_ANTENNAS>
+void Weighter<NUM_ANTENNAS>::Initialize(DataBlob<NUM_ANTENNAS> &blob)
 {
   (void) blob;
 }
 
-void Weighter::Run(DataBlob &b)
+template<int NUM_ANTENNAS>
+void Weighter<NUM_ANTENNAS>::Run(DataBlob<NUM_ANTENNAS> &b)
 {
-  constexpr int n = NUM_ANTENNAS == 288 ? (6*7/2) : (12*13/2);
   mMaxNum = 0;
-  for (int i = 0; i < n; i++)
+  for (int i = 0; i < Config<NUM_ANTENNAS>::NUM_WEIGHTS; i++)
     mMaxNum = std::max(b.mHdr->weights[i], mMaxNum);
 
   mBlob = &b;
@@ -40,26 +39,10 @@ void Weighter::Run(DataBlob &b)
   if (mMaxNum == 0)
     return;
 
-  Eigen::Map<Eigen::MatrixXcf, Eigen::Aligned>
-      raw(reinterpret_cast<std::complex<float>*>(b.mDatum->data()+sizeof(output_header_t)),
-          NUM_CHANNELS,
-          NUM_BASELINES);
-
-  int s0, s1;
-  float w;
-  for (int a0 = 0; a0 < NUM_ANTENNAS; a0++)
-  {
-    s0 = a0/NUM_ANTENNAS_PER_STATION;
-    for (int a1 = 0; a1 <= a0; a1++)
-    {
-      s1 = a1/NUM_ANTENNAS_PER_STATION;
-      w = b.mHdr->weights[Index(s0, s1)] / float(mMaxNum);
-      raw.col(Index(a0, a1)) *= w;
-    }
-  }
+  // the weights are applied while the Flagger reduces the channels, this
+  // saves a pass over the visibilities
+  for (int i = 0; i < Config<NUM_ANTENNAS>::NUM_WEIGHTS; i++)
+    b.mWeights(i) = b.mHdr->weights[i] / float(mMaxNum);
 }
 
-int32_t Weighter::Index(int i, int j)
-{
-  return i*(i+1)/2 + j;
-}
\ No newline at end of file
+INSTANTIATE_ANTENNAS(Weighter)
@@ -5,18 +5,17 @@
 
 #include "../datablob.h"
 
-class Weighter : public ProcessingModuleInterface<DataBlob>
+template<int NUM_ANTENNAS>
+class Weighter : public ProcessingModuleInterface<DataBlob<NUM_ANTENNAS>>
 {
 public:
   Weighter(){}
 
   virtual std::string Name();
-  virtual void Initialize(DataBlob &blob);
-  virtual void Run(DataBlob &blob);
+  virtual void Initialize(DataBlob<NUM_ANTENNAS> &blob);
+  virtual void Run(DataBlob<NUM_ANTENNAS> &blob);
 
 private:
-  int32_t Index(int i, int j);
-
   uint32_t mMaxNum;
-  DataBlob *mBlob;
+  DataBlob<NUM_ANTENNAS> *mBlob;
 };
@@ -0,0 +1,193 @@
+#include "reduction.h"
+#include "../config.h"
+#include "../utils/sigmaclip.h"
+
+#include <algorithm>
+
+/// Maximum number of floats per baseline, real and imaginary parts of all channels
+#define VIS_FLOATS (2*NUM_CHANNELS)
+/// Independent partial sums per baseline in MaskedMeans, a multiple of two
+#define LANES 8
+
+namespace reduction
+{
+
+static inline int Index(const int i, const int j)
+{
+  return i*(i+1)/2 + j;
+}
+
+// The baselines of antenna i against the antennas of one station share a
+// weight and are summed unweighted first. Every row of the lower triangle is
+// summed in single precision, at most 576 baselines, and added to the double
+// precision totals, which keeps the error of the large sums in check.
+template<int CHANNELS>
+static void ChannelSums(const std::complex<float> *vis,
+                        const int num_antennas,
+                        const int num_channels,
+                        const float *weights,
+                        const uint8_t *skip,
+                        std::complex<double> *sums)
+{
+  const float *v = reinterpret_cast<const float*>(vis);
+  const int n = 2*(CHANNELS ? CHANNELS : num_channels);
+  alignas(64) float station[VIS_FLOATS];
+  alignas(64) float row[VIS_FLOATS];
+  double total[VIS_FLOATS];
+  std::fill(total, total + n, 0.0);
+
+  for (int i = 0; i < num_antennas; i++)
+  {
+    if (skip && skip[i])
+    {
+      v += (i + 1) * n;
+      continue;
+    }
+
+    int s0 = i / NUM_ANTENNAS_PER_STATION;
+    std::fill(row, row + n, 0.0f);
+
+    for (int j0 = 0; j0 <= i; j0 += NUM_ANTENNAS_PER_STATION)
+    {
+      int j1 = std::min(j0 + NUM_ANTENNAS_PER_STATION, i + 1);
+      std::fill(station, station + n, 0.0f);
+
+      for (int j = j0; j < j1; j++, v += n)
+        if (!(skip && skip[j]))
+          for (int k = 0; k < n; k++)
+            station[k] += v[k];
+
+      float w = weights[Index(s0, j0 / NUM_ANTENNAS_PER_STATION)];
+      for (int k = 0; k < n; k++)
+        row[k] += w * station[k];
+    }
+
+    for (int k = 0; k < n; k++)
+      total[k] += row[k];
+  }
+
+  for (int c = 0; c < num_channels; c++)
+    sums[c] = std::complex<double>(total[2*c], total[2*c+1]);
+}
+
+// Channels are summed in LANES independent partial sums that alternate
+// between real and imaginary parts, so the loop vectorizes without
+// reassociating floating point additions.
+template<int CHANNELS>
+static void MaskedMeans(const std::complex<float> *vis,
+                        const int num_antennas,
+                        const int num_channels,
+                        const float *weights,
+                        const uint8_t *skip,
+                        const float *mask,
+                        const uint64_t *flags,
+                        std::complex<float> *means)
+{
+  const float *v = reinterpret_cast<const float*>(vis);
+  const int n = 2*(CHANNELS ? CHANNELS : num_channels);
+  alignas(64) float m[VIS_FLOATS];
+  float count = 0.0f;
+  uint64_t kept = 0;
+  for (int c = 0; c < num_channels; c++)
+  {
+    m[2*c] = m[2*c+1] = mask[c];
+    count += mask[c];
+    kept |= uint64_t(mask[c] != 0.0f) << c;
+  }
+
+  for (int i = 0, b = 0; i < num_antennas; i++)
+  {
+    int s0 = i / NUM_ANTENNAS_PER_STATION;
+    for (int j = 0; j <= i; j++, b++, v += n)
+    {
+      if (skip && (skip[i] || skip[j]))
+      {
+        means[b] = 0.0f;
+        continue;
+      }
+
+      float acc[LANES] = {};
+      int k = 0;
+      for (; k + LANES <= n; k += LANES)
+        for (int l = 0; l < LANES; l++)
+          acc[l] += m[k+l] * v[k+l];
+      for (; k < n; k += 2)
+      {
+        acc[0] += m[k] * v[k];
+        acc[1] += m[k+1] * v[k+1];
+      }
+
+      float re = 0.0f, im = 0.0f;
+      for (int l = 0; l < LANES; l += 2)
+      {
+        re += acc[l];
+        im += acc[l+1];
+      }
+
+      // flagged visibilities are zero and only change the number of channels
+      float used = flags ? count - __builtin_popcountll(flags[b] & kept) : count;
+      float w = weights[Index(s0, j / NUM_ANTENNAS_PER_STATION)] / used;
+      means[b] = std::complex<float>(w * re, w * im);
+    }
+  }
+}
+
+
+// A full subband has its own instantiation, with a compile time channel count
+// the loops over a baseline are unrolled.
+void ChannelSums(const std::complex<float> *vis,
+                 const int num_antennas,
+                 const int num_channels,
+                 const float *weights,
+                 const uint8_t *skip,
+                 std::complex<double> *sums)
+{
+  if (num_channels == NUM_CHANNELS)
+    ChannelSums<NUM_CHANNELS>(vis, num_antennas, num_channels, weights, skip, sums);
+  else
+    ChannelSums<0>(vis, num_antennas, num_channels, weights, skip, sums);
+}
+
+void MaskedMeans(const std::complex<float> *vis,
+                 const int num_antennas,
+                 const int num_channels,
+                 const float *weights,
+                 const uint8_t *skip,
+                 const float *mask,
+                 const uint64_t *flags,
+                 std::complex<float> *means)
+{
+  if (num_channels == NUM_CHANNELS)
+    MaskedMeans<NUM_CHANNELS>(vis, num_antennas, num_channels, weights, skip, mask, flags, means);
+  else
+    MaskedMeans<0>(vis, num_antennas, num_channels, weights, skip, mask, flags, means);
+}
+
+void AutoPowers(const std::complex<float> *vis,
+                const int num_antennas,
+                const int num_channels,
+                const float *weights,
+                const uint8_t *skip,
+                float *powers)
+{
+  alignas(64) float real[NUM_CHANNELS];
+  Map<VectorXf> r(real, num_channels);
+
+  for (int i = 0; i < num_antennas; i++)
+  {
+    if (skip && skip[i])
+    {
+      powers[i] = 0.0f;
+      continue;
+    }
+
+    const std::complex<float> *v = vis + std::size_t(Index(i, i)) * num_channels;
+    for (int c = 0; c < num_channels; c++)
+      real[c] = v[c].real();
+
+    int s = i / NUM_ANTENNAS_PER_STATION;
+    powers[i] = weights[Index(s, s)] * utils::Median(r);
+  }
+}
+
+}
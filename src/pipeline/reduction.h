@@ -0,0 +1,58 @@
+#pragma once
+
+#include <complex>
+#include <cstdint>
+
+/**
+ * Reductions over the visibilities of one polarization, num_channels
+ * consecutive channels per baseline with baselines in correlator order. Both
+ * passes only read the visibilities, the station weights are applied on the
+ * fly, so an integration is streamed from memory twice instead of being
+ * rewritten by the Weighter and read four times by the Flagger.
+ */
+namespace reduction
+{
+/**
+ * @brief
+ * First pass, sums the weighted visibilities of every channel over all
+ * baselines. weights holds a weight per station pair in baseline order.
+ * skip, when not null, holds a byte per antenna, the baselines of antennas
+ * for which it is set are left out.
+ */
+void ChannelSums(const std::complex<float> *vis,
+                 const int num_antennas,
+                 const int num_channels,
+                 const float *weights,
+                 const uint8_t *skip,
+                 std::complex<double> *sums);
+
+/**
+ * @brief
+ * Second pass, the weighted mean of every baseline over the channels for
+ * which mask is one. flags, when not null, holds a bit per channel for every
+ * baseline for visibilities that were zeroed and do not count towards the
+ * mean. A baseline is NaN when every channel is masked or flagged and zero
+ * when one of its antennas is skipped.
+ */
+void MaskedMeans(const std::complex<float> *vis,
+                 const int num_antennas,
+                 const int num_channels,
+                 const float *weights,
+                 const uint8_t *skip,
+                 const float *mask,
+                 const uint64_t *flags,
+                 std::complex<float> *means);
+
+/**
+ * @brief
+ * The weighted power of every antenna, the median over the channels of its
+ * autocorrelation. Only the autocorrelations are read. Skipped antennas
+ * have zero power.
+ */
+void AutoPowers(const std::complex<float> *vis,
+                const int num_antennas,
+                const int num_channels,
+                const float *weights,
+                const uint8_t *skip,
+                float *powers);
+}
@@ -0,0 +1,218 @@
+#include "rfi_flagger.h"
+#include "../config.h"
+
+#include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace sumthreshold;
+
+template<int NUM_ANTENNAS>
+RFIFlagger<NUM_ANTENNAS>::RFIFlagger(const float threshold, const int depth, const std::vector<int> &affinity):
+  mThreshold(threshold),
+  mDepth(depth),
+  mStop(false)
+{
+  // rows of the lower triangle with roughly the same number of baselines per part
+  const int parts = affinity.size() + 1;
+  for (int k = 0; k < parts; k++)
+    mRows.push_back(int(std::round(std::sqrt(2.0 * k * Config<NUM_ANTENNAS>::NUM_BASELINES / parts))));
+  mRows.push_back(NUM_ANTENNAS);
+
+  for (auto cpu : affinity)
+    mThreads.emplace_back(&RFIFlagger<NUM_ANTENNAS>::Work, this, cpu);
+}
+
+template<int NUM_ANTENNAS>
+RFIFlagger<NUM_ANTENNAS>::~RFIFlagger()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStop = true;
+  }
+  mStart.notify_all();
+  for (auto &t : mThreads)
+    t.join();
+}
+
+template<int NUM_ANTENNAS>
+int RFIFlagger<NUM_ANTENNAS>::Run(std::complex<float> *vis, const int num_channels, const int key, const double start, const double end,
+                                  uint64_t *flags, const uint8_t *skip)
+{
+  const std::size_t size = std::size_t(Config<NUM_ANTENNAS>::NUM_BASELINES) * num_channels;
+  Job job;
+  job.vis = vis;
+  job.channels = num_channels;
+  job.skip = skip;
+  job.flags = flags;
+  job.past.resize(mDepth);
+  job.valid = 0;
+  job.current = nullptr;
+  job.next = job.done = job.count = 0;
+
+  History *h = nullptr;
+  if (mDepth > 0)
+  {
+    // the ring of key is ours until this integration is flagged
+    std::unique_lock<std::mutex> lock(mHistoryMutex);
+    h = &mHistory[key];
+    mHistoryFree.wait(lock, [h]{ return !h->busy; });
+    h->busy = true;
+    lock.unlock();
+
+    if (h->samples.size() != mDepth * size)
+    {
+      h->samples.assign(mDepth * size, 0);
+      h->times.assign(mDepth, 0.0);
+      h->head = 0;
+    }
+
+    // only the integrations directly preceding this one, most recent first,
+    // one that arrives after a later integration of key leaves the ring alone
+    const double duration = end - start;
+    const int last = (h->head - 1 + mDepth) % mDepth;
+    if (h->times[last] < start + 0.5 * duration)
+    {
+      for (int k = 1; k <= mDepth; k++)
+      {
+        int slot = (h->head - k + mDepth) % mDepth;
+        if (std::abs(h->times[slot] - (start - (k - 1) * duration)) > 0.5 * duration)
+          break;
+        job.past[job.valid++] = &h->samples[slot * size];
+      }
+
+      job.current = &h->samples[h->head * size];
+      h->times[h->head] = end;
+      h->head = (h->head + 1) % mDepth;
+    }
+  }
+
+  const int parts = mRows.size() - 1;
+  std::unique_lock<std::mutex> lock(mMutex);
+  if (parts > 1)
+  {
+    mJobs.push_back(&job);
+    mStart.notify_all();
+  }
+  Take(job, lock);
+  mDone.wait(lock, [&]{ return job.done == parts; });
+  lock.unlock();
+
+  if (h)
+  {
+    {
+      std::lock_guard<std::mutex> history(mHistoryMutex);
+      h->busy = false;
+    }
+    mHistoryFree.notify_all();
+  }
+
+  return job.count;
+}
+
+template<int NUM_ANTENNAS>
+void RFIFlagger<NUM_ANTENNAS>::Take(Job &job, std::unique_lock<std::mutex> &lock)
+{
+  // flags parts of job until none is left, called with lock held
+  const int parts = mRows.size() - 1;
+  while (job.next < parts)
+  {
+    int part = job.next++;
+    if (job.next == parts && parts > 1)
+      mJobs.erase(std::find(mJobs.begin(), mJobs.end(), &job));
+
+    lock.unlock();
+    int count = Flag(job, part);
+    lock.lock();
+
+    job.count += count;
+    if (++job.done == parts)
+      mDone.notify_all();
+  }
+}
+
+template<int NUM_ANTENNAS>
+void RFIFlagger<NUM_ANTENNAS>::Work(const int cpu)
+{
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  CPU_SET(cpu, &cpuset);
+  int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+  CHECK(rc == 0) << "pthread_setaffinity_np failed for cpu " << cpu;
+
+  std::unique_lock<std::mutex> lock(mMutex);
+  while (true)
+  {
+    mStart.wait(lock, [this]{ return mStop || !mJobs.empty(); });
+    if (mStop)
+      return;
+
+    // one part at a time, so the workers spread over the waiting jobs
+    Job &job = *mJobs.front();
+    const int parts = mRows.size() - 1;
+    int part = job.next++;
+    if (job.next == parts)
+      mJobs.pop_front();
+
+    lock.unlock();
+    int count = Flag(job, part);
+    lock.lock();
+
+    job.count += count;
+    if (++job.done == parts)
+      mDone.notify_all();
+  }
+}
+
+template<int NUM_ANTENNAS>
+int RFIFlagger<NUM_ANTENNAS>::Flag(const Job &job, const int part)
+{
+  const int n = job.channels;
+  alignas(64) float z[64];
+  const Sample *past[sizeof(uint64_t)*8];
+  int count = 0;
+
+  for (int i = mRows[part]; i < mRows[part+1]; i++)
+  {
+    std::size_t b = std::size_t(i) * (i + 1) / 2;
+    for (int j = 0; j <= i; j++, b++)
+    {
+      // the bandpass shape dominates the autocorrelations, they are kept as
+      // are the baselines of skipped antennas
+      if (i == j || (job.skip && (job.skip[i] || job.skip[j])))
+      {
+        if (job.flags)
+          job.flags[b] = 0;
+        if (job.current)
+          std::memset(job.current + b * n, 0, n * sizeof(Sample));
+        continue;
+      }
+
+      std::complex<float> *v = job.vis + b * n;
+      Normalize(v, n, z);
+      uint64_t flags = Frequency(z, n, mThreshold);
+
+      if (job.valid)
+      {
+        for (int k = 0; k < job.valid; k++)
+          past[k] = job.past[k] + b * n;
+        flags = Time(z, past, job.valid, n, mThreshold, flags);
+      }
+
+      if (job.current)
+        Quantize(z, n, flags, job.current + b * n);
+
+      for (uint64_t f = flags; f; f &= f - 1)
+        v[__builtin_ctzll(f)] = 0.0f;
+
+      if (job.flags)
+        job.flags[b] = flags;
+      count += __builtin_popcountll(flags);
+    }
+  }
+
+  return count;
+}
+
+INSTANTIATE_ANTENNAS(RFIFlagger)
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <complex>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "sumthreshold.h"
+
+/**
+ * Flags single visibilities with SumThreshold across the channels of every
+ * cross correlation and across the last depth integrations of the same
+ * subband and polarization, and zeroes them. The normalized deviations of
+ * past integrations are kept in a ring per subband and polarization, shared
+ * by every thread that calls Run: integrations of the same key are flagged
+ * one after the other, different keys at the same time. The baselines of an
+ * integration are split in parts, taken by the calling thread and by one
+ * worker per cpu in affinity.
+ */
+template<int NUM_ANTENNAS>
+class RFIFlagger
+{
+public:
+  RFIFlagger(const RFIFlagger&) = delete;
+  RFIFlagger& operator=(const RFIFlagger&) = delete;
+
+  RFIFlagger(const float threshold, const int depth, const std::vector<int> &affinity);
+  ~RFIFlagger();
+
+  /**
+   * @brief
+   * Flags the visibilities of one integration of num_channels channels per
+   * baseline in place and returns the number of visibilities flagged. flags
+   * receives a bit per channel for every baseline, set for the visibilities
+   * zeroed. Past integrations of key are only used when they ended at most
+   * depth integrations before start, an integration older than the last one
+   * of key is flagged across channels only. The baselines of antennas set in
+   * skip, when not null, are left alone. Safe to call from several threads.
+   */
+  int Run(std::complex<float> *vis, const int num_channels, const int key, const double start, const double end,
+          uint64_t *flags, const uint8_t *skip = nullptr);
+
+private:
+  struct History
+  {
+    History(): head(0), busy(false) {}
+
+    std::vector<sumthreshold::Sample> samples;
+    std::vector<double> times;
+    int head;
+    bool busy; ///< an integration of this key is being flagged
+  };
+
+  /// An integration being flagged, its parts are taken by the caller and the workers
+  struct Job
+  {
+    std::complex<float> *vis;
+    int channels;
+    const uint8_t *skip;
+    uint64_t *flags;
+    std::vector<const sumthreshold::Sample*> past;
+    int valid;
+    sumthreshold::Sample *current;
+    int next;  ///< next part to take
+    int done;  ///< parts finished
+    int count; ///< visibilities flagged so far
+  };
+
+  void Work(const int cpu);
+  void Take(Job &job, std::unique_lock<std::mutex> &lock);
+  int Flag(const Job &job, const int part);
+
+  float mThreshold;
+  int mDepth;
+  std::vector<int> mRows;
+
+  std::mutex mHistoryMutex;
+  std::condition_variable mHistoryFree;
+  std::map<int, History> mHistory;
+
+  std::vector<std::thread> mThreads;
+  std::mutex mMutex;
+  std::condition_variable mStart;
+  std::condition_variable mDone;
+  std::deque<Job*> mJobs; ///< jobs with parts not yet taken, oldest first
+  bool mStop;
+};
@@ -0,0 +1,67 @@
+#include "subspace.h"
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+/// Additional basis vectors of a cold start
+#define OVERSAMPLE 4
+
+namespace subspace
+{
+/// Orthonormal basis of the columns of Z
+static void Orthonormalize(const Eigen::MatrixXcf &Z, Eigen::MatrixXcf &Q)
+{
+  Eigen::HouseholderQR<Eigen::MatrixXcf> qr(Z);
+  Q = qr.householderQ() * Eigen::MatrixXcf::Identity(Z.rows(), Z.cols());
+}
+
+int Dominant(const Eigen::MatrixXcf &R, const int k, Eigen::MatrixXcf &Q, Eigen::VectorXf &values,
+             const float tolerance, const int max_iterations)
+{
+  const int n = R.rows();
+  if (Q.rows() != n || Q.cols() < k)
+    Orthonormalize(Eigen::MatrixXcf::Random(n, std::min(n, k + OVERSAMPLE)), Q);
+
+  const int m = Q.cols();
+  Eigen::MatrixXcf Z(n, m), V(n, m), RV(n, m), H(m, m), Y(m, m);
+  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXcf> solver(m);
+  std::vector<int> order(m);
+  values.resize(m);
+
+  for (int it = 1; it <= max_iterations; it++)
+  {
+    // Rayleigh-Ritz on the span of Q
+    Z.noalias() = R * Q;
+    H.noalias() = Q.adjoint() * Z;
+    solver.compute(H);
+
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+      return std::abs(solver.eigenvalues()(a)) > std::abs(solver.eigenvalues()(b));
+    });
+    for (int j = 0; j < m; j++)
+    {
+      Y.col(j) = solver.eigenvectors().col(order[j]);
+      values(j) = std::abs(solver.eigenvalues()(order[j]));
+    }
+    V.noalias() = Q * Y;
+    RV.noalias() = Z * Y;
+
+    float residual = 0.0f;
+    for (int j = 0; j < k; j++)
+      residual = std::max(residual, (RV.col(j) - solver.eigenvalues()(order[j]) * V.col(j)).norm());
+
+    if (residual <= tolerance * values(0))
+    {
+      Q = V;
+      return it;
+    }
+
+    Orthonormalize(RV, Q);
+  }
+
+  Q = V;
+  return -1;
+}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Eigen/Dense>
+
+/**
+ * Dominant eigenpairs of a hermitian matrix by subspace iteration with
+ * Rayleigh-Ritz, the eigenvalues largest in absolute value first. An
+ * iteration costs one product of the N x N matrix with the N x m basis, so
+ * the few eigenpairs of the sources cost O(N^2 m) per iteration instead of
+ * the O(N^3) of a full decomposition. A basis of the previous integration
+ * converges in a few iterations.
+ */
+namespace subspace
+{
+/**
+ * @brief
+ * Computes the k dominant eigenpairs of R. Q holds the starting basis, its
+ * columns beyond k speed up convergence; a basis with other dimensions is
+ * replaced by a random one of k + 4 columns. On return Q holds the Ritz
+ * vectors, the first k are the eigenvectors, and values the absolute Ritz
+ * values in descending order. Returns the number of iterations, or -1 when
+ * the residuals of the first k are not below tolerance times the largest
+ * eigenvalue after max_iterations.
+ */
+int Dominant(const Eigen::MatrixXcf &R, const int k, Eigen::MatrixXcf &Q, Eigen::VectorXf &values,
+             const float tolerance = 1e-4f, const int max_iterations = 50);
+}
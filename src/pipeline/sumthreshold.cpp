@@ -0,0 +1,152 @@
+#include "sumthreshold.h"
+
+#include <algorithm>
+#include <cmath>
+
+/// Largest window, a quarter of a subband
+#define MAX_WINDOW 16
+/// Threshold reduction per doubling of the window
+#define RHO 1.5f
+/// Samples per sigma in the history
+#define SAMPLE_SCALE 8.0f
+/// History sample of a flagged visibility
+#define SAMPLE_FLAGGED -128
+
+namespace sumthreshold
+{
+
+static inline uint64_t Window(const int start, const int width)
+{
+  return ((uint64_t(1) << width) - 1) << start;
+}
+
+// The median of at most 64 values by counting the rank of every value, the
+// comparisons vectorize where nth_element mispredicts most of its branches.
+// Equal values are ranked by position, so exactly one value has every rank.
+static float Median(const float *a, const int n)
+{
+  const int h = n >> 1;
+  float upper = 0.0f, lower = 0.0f;
+  int found = 0;
+
+  // if n is even the median is the mean of the values ranked h-1 and h
+  for (int i = 0; i < n; i++)
+  {
+    const float x = a[i];
+    int rank = 0;
+    for (int j = 0; j < i; j++)
+      rank += a[j] <= x;
+    for (int j = i + 1; j < n; j++)
+      rank += a[j] < x;
+
+    if (rank == h)
+    {
+      upper = x;
+      if (n & 1)
+        return upper;
+      found++;
+    }
+    else if (rank == h - 1)
+    {
+      lower = x;
+      found++;
+    }
+
+    if (found == 2)
+      break;
+  }
+
+  return 0.5f * (lower + upper);
+}
+
+void Normalize(const std::complex<float> *vis, const int num_channels, float *z)
+{
+  alignas(64) float amplitude[64];
+  alignas(64) float scratch[64];
+
+  // std::abs guards against overflow with hypot, which does not vectorize
+  const float *v = reinterpret_cast<const float*>(vis);
+  for (int c = 0; c < num_channels; c++)
+    amplitude[c] = std::sqrt(v[2*c]*v[2*c] + v[2*c+1]*v[2*c+1]);
+
+  float median = Median(amplitude, num_channels);
+
+  for (int c = 0; c < num_channels; c++)
+    scratch[c] = std::abs(amplitude[c] - median);
+  float sigma = 1.4826f * Median(scratch, num_channels);
+
+  float scale = sigma > 0.0f ? 1.0f / sigma : 0.0f;
+  for (int c = 0; c < num_channels; c++)
+    z[c] = (amplitude[c] - median) * scale;
+}
+
+uint64_t Frequency(const float *z, const int num_channels, const float threshold)
+{
+  alignas(64) float v[64];
+  uint64_t flags = 0;
+
+  for (int c = 0; c < num_channels; c++)
+    flags |= uint64_t(z[c] > threshold) << c;
+
+  float chi = threshold;
+  for (int w = 2; w <= MAX_WINDOW && w <= num_channels; w *= 2)
+  {
+    chi /= RHO;
+    for (int c = 0; c < num_channels; c++)
+      v[c] = (flags >> c) & 1 ? chi : z[c];
+
+    float sum = 0.0f;
+    for (int c = 0; c < w; c++)
+      sum += v[c];
+
+    // windows found in this pass do not affect the others of the same width
+    uint64_t found = 0;
+    const float limit = w * chi;
+    for (int c = w; ; c++)
+    {
+      if (sum > limit)
+        found |= Window(c - w, w);
+      if (c == num_channels)
+        break;
+      sum += v[c] - v[c - w];
+    }
+
+    flags |= found;
+  }
+
+  return flags;
+}
+
+uint64_t Time(const float *z, const Sample *const *past, const int depth, const int num_channels,
+              const float threshold, uint64_t flags)
+{
+  alignas(64) float sum[64];
+
+  float chi = threshold;
+  for (int w = 2; w <= depth + 1; w *= 2)
+  {
+    chi /= RHO;
+
+    // flagged past samples count at the threshold, as in Frequency
+    std::copy(z, z + num_channels, sum);
+    for (int k = 0; k < w - 1; k++)
+      for (int c = 0; c < num_channels; c++)
+        sum[c] += past[k][c] == SAMPLE_FLAGGED ? chi : past[k][c] * (1.0f / SAMPLE_SCALE);
+
+    const float limit = w * chi;
+    for (int c = 0; c < num_channels; c++)
+      flags |= uint64_t(sum[c] > limit) << c;
+  }
+
+  return flags;
+}
+
+void Quantize(const float *z, const int num_channels, const uint64_t flags, Sample *q)
+{
+  for (int c = 0; c < num_channels; c++)
+    q[c] = Sample(std::max(-127.0f, std::min(127.0f, std::nearbyint(z[c] * SAMPLE_SCALE))));
+  for (uint64_t f = flags; f; f &= f - 1)
+    q[__builtin_ctzll(f)] = SAMPLE_FLAGGED;
+}
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <complex>
+#include <cstdint>
+
+/**
+ * SumThreshold flagging of single visibilities (Offringa et al. 2010). The
+ * amplitudes of a baseline are normalized to robust sigmas from their median
+ * over the channels, after which windows of 1, 2, 4, 8 and 16 consecutive
+ * channels are flagged when their mean exceeds a threshold that drops by a
+ * factor 1.5 per doubling of the window. Flagged channels count at the
+ * threshold of the next window, so one strong spike does not flag its
+ * neighbours. Flags are a bit per channel, at most 64 channels.
+ */
+namespace sumthreshold
+{
+/// Past deviations are kept in eighths of a sigma
+typedef int8_t Sample;
+
+/**
+ * @brief
+ * Writes the deviation of the amplitude of every channel from the median
+ * amplitude of the baseline to z, in units of 1.4826 times the median
+ * absolute deviation. z is all zero when the amplitudes are constant.
+ */
+void Normalize(const std::complex<float> *vis, const int num_channels, float *z);
+
+/**
+ * @brief
+ * Flags windows of channels of the normalized amplitudes z, threshold is the
+ * deviation at which a single channel is flagged.
+ */
+uint64_t Frequency(const float *z, const int num_channels, const float threshold);
+
+/**
+ * @brief
+ * Flags channels whose deviation, together with the deviations of the same
+ * channel in the depth previous integrations, exceeds the window thresholds
+ * over time. past holds a pointer per integration, the most recent first.
+ * Channels in flags are not tested again, the result includes them.
+ */
+uint64_t Time(const float *z, const Sample *const *past, const int depth, const int num_channels,
+              const float threshold, uint64_t flags);
+
+/// Converts normalized deviations and the flags of a baseline for its history
+void Quantize(const float *z, const int num_channels, const uint64_t flags, Sample *q);
+}
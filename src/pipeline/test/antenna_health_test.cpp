@@ -0,0 +1,130 @@
+#include "../antenna_health.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <thread>
+
+using namespace ::testing;
+
+class AntennaHealthTest : public Test {
+
+protected:
+  static const int A = 288;
+
+  AntennaHealthTest():
+    mHealth({3, 250}, 4.0f),
+    mPower(A),
+    mMask(Eigen::VectorXf::Ones(A))
+  {
+  }
+
+  /// Powers around one with a percent of noise
+  void Integration() {
+    std::normal_distribution<float> normal(1.0f, 0.01f);
+    for (int i = 0; i < A; i++)
+      mPower(i) = mMask(i) ? normal(mGen) : 0.0f;
+  }
+
+  std::vector<uint8_t> Skip(const int key) {
+    std::vector<uint8_t> skip;
+    mHealth.Skip(key, skip);
+    return skip;
+  }
+
+  AntennaHealth<A> mHealth;
+  Eigen::VectorXf mPower;
+  Eigen::VectorXf mMask;
+  std::mt19937 mGen;
+};
+
+TEST_F(AntennaHealthTest, Static) {
+  auto skip = Skip(0);
+  for (int i = 0; i < A; i++)
+    EXPECT_EQ(skip[i], i == 3 || i == 250);
+}
+
+TEST_F(AntennaHealthTest, Learned) {
+  mMask(3) = mMask(250) = mMask(17) = 0.0f;
+  for (int t = 0; t < 10; t++)
+  {
+    EXPECT_FALSE(Skip(1)[17]);
+    Integration();
+    mHealth.Update(1, mPower, mMask);
+  }
+
+  // other subbands and polarizations learn on their own
+  EXPECT_FALSE(Skip(0)[17]);
+
+  // until the periodic check of the learned antennas
+  int skipped = 0;
+  for (int t = 10; t < 60; t++)
+  {
+    skipped += Skip(1)[17];
+    EXPECT_TRUE(Skip(1)[3]);
+    Integration();
+    mHealth.Update(1, mPower, mMask);
+  }
+  EXPECT_EQ(skipped, 49);
+
+  // and an antenna that recovered is used again
+  mMask(17) = 1.0f;
+  Integration();
+  mHealth.Update(1, mPower, mMask);
+  EXPECT_FALSE(Skip(1)[17]);
+}
+
+TEST_F(AntennaHealthTest, Expected) {
+  mMask(3) = mMask(250) = 0.0f;
+  for (int t = 0; t < 10; t++)
+  {
+    Integration();
+    EXPECT_FALSE(mHealth.Expected(0, mPower, mMask));
+    mHealth.Update(0, mPower, mMask);
+  }
+
+  for (int t = 0; t < 20; t++)
+  {
+    Integration();
+    EXPECT_TRUE(mHealth.Expected(0, mPower, mMask));
+    mHealth.Update(0, mPower, mMask);
+  }
+
+  Integration();
+  mPower(100) *= 1.5f;
+  EXPECT_FALSE(mHealth.Expected(0, mPower, mMask));
+
+  // a flagged antenna in the mask needs a full check
+  Integration();
+  mMask(3) = 1.0f;
+  mPower(3) = 1.0f;
+  EXPECT_FALSE(mHealth.Expected(0, mPower, mMask));
+}
+
+TEST_F(AntennaHealthTest, Changed) {
+  for (int t = 0; t < 15; t++)
+  {
+    Integration();
+    mHealth.Update(0, mPower, mMask);
+  }
+  EXPECT_TRUE(mHealth.Expected(0, mPower, mMask));
+
+  // a new flag restarts the count of stable integrations
+  mMask(40) = 0.0f;
+  Integration();
+  mHealth.Update(0, mPower, mMask);
+  EXPECT_FALSE(mHealth.Expected(0, mPower, mMask));
+}
+
+TEST_F(AntennaHealthTest, Threads) {
+  mMask(17) = 0.0f;
+  for (int t = 0; t < 10; t++)
+    Integration();
+
+  // processing threads take turns, the count of a key spans all of them
+  for (int t = 0; t < 10; t++)
+  {
+    std::thread thread([this]() { mHealth.Update(1, mPower, mMask); });
+    thread.join();
+  }
+  EXPECT_TRUE(Skip(1)[17]);
+  EXPECT_TRUE(mHealth.Expected(1, mPower, mMask));
+}
@@ -0,0 +1,44 @@
+#include "../datablob.h"
+#include "../../config.h"
+#include <gtest/gtest.h>
+
+using namespace ::testing;
+
+TEST(DataBlobTest, Collapsed) {
+  const int A = 288;
+  const int M = 10;
+  Datum datum(sizeof(output_header_t) + Config<A>::NUM_BASELINES*M*sizeof(std::complex<float>), 0);
+  DataBlob<A> blob;
+  blob.Prepare(datum);
+  blob.mHdr->subband = 296;
+  blob.mHdr->flagged_dipoles[17] = true;
+  for (int i = 0; i < A; i++)
+    for (int j = 0; j <= i; j++)
+      blob.mACM.Row(i)[j] = std::complex<float>(i, j);
+
+  // the calibration pipeline picks up where the channel pipeline stopped
+  blob.mHdr->magic = OUTPUT_MAGIC;
+  Datum collapsed = blob.Serialize();
+  ASSERT_EQ(collapsed.size(), DataBlob<A>::CollapsedSize());
+  reinterpret_cast<output_header_t*>(collapsed.data())->magic = FORWARDED_MAGIC;
+
+  DataBlob<A> next;
+  next.Prepare(collapsed);
+  EXPECT_EQ(next.mHdr->subband, 296);
+  EXPECT_TRUE(next.mHdr->flagged_dipoles[17]);
+  EXPECT_EQ(next.mACM(100, 40), std::complex<float>(100, 40));
+  EXPECT_EQ(next.mACM(40, 100), std::complex<float>(100, -40));
+  EXPECT_EQ(next.mHdr->magic, uint64_t(OUTPUT_MAGIC));
+
+  // an integration of a single channel has the size of a serialized blob
+  Datum single = blob.Serialize();
+  DataBlob<A> channel;
+  channel.Prepare(single);
+  EXPECT_FALSE(channel.mHdr->flagged_dipoles[17]);
+  EXPECT_EQ(channel.mACM(100, 40), std::complex<float>(0.0f));
+
+  // while a channelised integration starts over
+  blob.Prepare(datum);
+  EXPECT_FALSE(blob.mHdr->flagged_dipoles[17]);
+  EXPECT_EQ(blob.mACM(100, 40), std::complex<float>(0.0f));
+}
@@ -0,0 +1,166 @@
+#include "../pmodules/flagger.h"
+#include "../datablob.h"
+#include "../../simulator/simulator.h"
+#include "../../utils/antenna_positions.h"
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+
+DEFINE_double(antsigma, 4.0, "Sigma used for clipping of antennas");
+DEFINE_double(vissigma, 3.0, "Sigma used for clipping of visibilities across channels");
+DEFINE_double(rfisigma, 6.0, "Sigma at which single visibilities are flagged for rfi across channels and time, 0 disables");
+DEFINE_int32(rfiwindow, 3, "Number of past integrations per subband and polarization used to flag rfi in time, at most 15");
+DEFINE_string(rfi_affinity, "", "Cpus of rfi flagging threads shared by all processing threads e.g. 8,9, by default each processing thread flags alone");
+DEFINE_string(flagged_dipoles, "", "Antennas known to be bad e.g. '3,17,250', they are flagged without being looked at");
+DEFINE_string(antenna_power, "acm", "Antenna power to flag on: acm (column means of the ACM), auto (autocorrelations, bad antennas are left out of the reductions) or compare (acm, and logs where auto disagrees)");
+
+using namespace ::testing;
+
+class FlaggerTest : public Test {
+
+protected:
+  static const int A = 288;
+
+  static void SetUpTestCase() {
+    std::string dir(__FILE__);
+    dir = dir.substr(0, dir.rfind('/'));
+    AntennaPositions::CreateInstance(dir + "/../../../data/antennasets/lba_outer.dat");
+  }
+
+  /// The XX polarization of a simulated integration, as ingest hands it to the pipeline
+  void Render(Simulator<A> &sim, const double time, Datum &datum) {
+    std::vector<uint8_t> data;
+    sim.Generate(time, data);
+    const input_header_t *in = reinterpret_cast<const input_header_t*>(data.data());
+    const std::complex<float> *vis = reinterpret_cast<const std::complex<float>*>(data.data() + sizeof(input_header_t));
+
+    datum.resize(sizeof(output_header_t) + Config<A>::NUM_BASELINES*NUM_CHANNELS*sizeof(std::complex<float>));
+    memset(datum.data(), 0, sizeof(output_header_t));
+    output_header_t *hdr = reinterpret_cast<output_header_t*>(datum.data());
+    hdr->start_time = in->startTime;
+    hdr->end_time = in->endTime;
+    hdr->subband = 296;
+    hdr->num_antennas = A;
+    hdr->num_channels = NUM_CHANNELS + 1;
+    hdr->flagged_channels[0] = true;
+    std::copy(in->weights, in->weights + 78, hdr->weights);
+
+    std::complex<float> *out = reinterpret_cast<std::complex<float>*>(datum.data() + sizeof(output_header_t));
+    for (int i = 0, n = Config<A>::NUM_BASELINES*NUM_CHANNELS; i < n; i++)
+      out[i] = vis[i*NUM_POLARIZATIONS];
+  }
+
+  /// Flags integrations of sim with both power estimates, counts the antennas where they disagree
+  void Compare(Simulator<A> &sim, const int integrations, int &flagged, int &disagree) {
+    FLAGS_antenna_power = "acm";
+    Flagger<A> acm;
+    FLAGS_antenna_power = "auto";
+    Flagger<A> autos;
+    DataBlob<A> a, b;
+    Datum x, y;
+
+    flagged = disagree = 0;
+    for (int t = 0; t < integrations; t++)
+    {
+      Render(sim, 1.5e9 + t, x);
+      y = x;
+      a.Prepare(x);
+      b.Prepare(y);
+      if (t == 0)
+      {
+        acm.Initialize(a);
+        autos.Initialize(b);
+      }
+      acm.Run(a);
+      autos.Run(b);
+
+      for (auto d : sim.DeadDipoles())
+      {
+        EXPECT_TRUE(a.mHdr->flagged_dipoles[d]);
+        EXPECT_TRUE(b.mHdr->flagged_dipoles[d]);
+      }
+      flagged += a.mHdr->flagged_dipoles.count();
+      disagree += (a.mHdr->flagged_dipoles ^ b.mHdr->flagged_dipoles).count();
+    }
+    FLAGS_antenna_power = "acm";
+  }
+};
+
+TEST_F(FlaggerTest, DeadDipoles) {
+  Simulator<A> sim(296, 3);
+  sim.SetGains(0.05f, 0.5f);
+  sim.SetDeadDipoles(12);
+
+  int flagged, disagree;
+  Compare(sim, 3, flagged, disagree);
+  EXPECT_GE(flagged, 3*12);
+  RecordProperty("disagree", disagree);
+}
+
+TEST_F(FlaggerTest, Accuracy) {
+  Simulator<A> sim(296, 7);
+  sim.SetGains(0.2f, 1.0f);
+  sim.SetNoise(0.5f);
+  sim.SetDeadDipoles(20);
+
+  // over a run of integrations as a replayed recording would give them
+  int flagged, disagree;
+  Compare(sim, 12, flagged, disagree);
+  RecordProperty("flagged", flagged);
+  RecordProperty("disagree", disagree);
+  EXPECT_LE(disagree, 12*A/50);
+}
+
+TEST_F(FlaggerTest, AutoExcludesFlagged) {
+  Simulator<A> sim(296, 5);
+  sim.SetDeadDipoles(8);
+  FLAGS_antenna_power = "auto";
+  Flagger<A> flagger;
+  DataBlob<A> blob;
+  Datum datum;
+  Render(sim, 1.5e9, datum);
+  blob.Prepare(datum);
+  flagger.Initialize(blob);
+  flagger.Run(blob);
+  FLAGS_antenna_power = "acm";
+
+  for (int i = 0; i < A; i++)
+    if (blob.mHdr->flagged_dipoles[i])
+    {
+      for (int j = 0; j < A; j++)
+        EXPECT_EQ(std::norm(blob.mACM(i, j)), 0.0f);
+    }
+}
+
+TEST_F(FlaggerTest, ProcessingThreads) {
+  // with two processing cpus every Flagger sees every other integration, the
+  // shared state still follows the whole stream as a single Flagger does
+  Simulator<A> sim(296, 11);
+  sim.SetGains(0.2f, 1.0f);
+  sim.SetNoise(0.5f);
+  sim.SetDeadDipoles(10);
+  FlaggerState<A> state;
+  Flagger<A> single, first(state), second(state);
+  DataBlob<A> a, b;
+  Datum x, y;
+
+  for (int t = 0; t < 8; t++)
+  {
+    Render(sim, 1.5e9 + t, x);
+    y = x;
+    a.Prepare(x);
+    b.Prepare(y);
+    Flagger<A> &worker = t % 2 ? second : first;
+    if (t == 0)
+    {
+      single.Initialize(a);
+      first.Initialize(b);
+      second.Initialize(b);
+    }
+    single.Run(a);
+    worker.Run(b);
+
+    EXPECT_EQ(a.mHdr->flagged_dipoles, b.mHdr->flagged_dipoles);
+    EXPECT_EQ(a.mHdr->flagged_channels, b.mHdr->flagged_channels);
+    EXPECT_TRUE(x == y);
+  }
+}
@@ -0,0 +1,146 @@
+#include "../gain_solver.h"
+#include <gtest/gtest.h>
+
+using namespace ::testing;
+
+namespace reference
+{
+/// The minor cycles as the calibrator did them before the gain solver
+int gainSolv(const Eigen::MatrixXcf &model, const Eigen::MatrixXcf &data, const Eigen::VectorXcf &estimated, const int max_cycles, const float epsilon, Eigen::VectorXcf &gains)
+{
+  const int n = model.rows();
+  Eigen::MatrixXcf data_normalised(n, n);
+  Eigen::MatrixXcf data_calibrated(n, n);
+  Eigen::VectorXcf estimated_calibration(n);
+  Eigen::VectorXcf tmp(n);
+  gains.resize(n);
+
+  for (int i = 0; i < n; i++)
+  {
+    data_normalised.col(i) = data.col(i) / data.col(i).dot(data.col(i));
+    data_calibrated.col(i) = estimated.array() * model.col(i).array();
+  }
+
+  int i;
+  for (i = 1; i <= max_cycles; i++)
+  {
+    for (int j = 0; j < n; j++)
+    {
+      estimated_calibration(j) = data_normalised.col(j).dot(data_calibrated.col(j));
+      gains(j) = 1.0f / std::conj(estimated_calibration(j));
+    }
+
+    if (i % 2 == 1)
+      tmp = gains;
+    else
+    {
+      estimated_calibration = gains;
+      gains = (gains.array() + tmp.array()) / 2.0f;
+      tmp = gains.array() - estimated_calibration.array();
+      if (tmp.norm() / gains.norm() <= epsilon)
+        break;
+    }
+
+    for (int j = 0; j < n; j++)
+      data_calibrated.col(j) = gains.array() * model.col(j).array();
+  }
+
+  return i;
+}
+}
+
+class GainSolverTest : public TestWithParam<std::string> {
+
+protected:
+  static const int N = 100;
+
+  virtual void SetUp() {
+    mSupported = gainsolve::Supported(GetParam());
+  }
+
+  /// A model of three sources and data with the gains g applied, the autocorrelations masked
+  void Problem(const int seed, Eigen::MatrixXcf &model, Eigen::MatrixXcf &data, Eigen::VectorXcf &gains) {
+    std::srand(seed);
+    Eigen::MatrixXcf A = Eigen::MatrixXcf::Random(N, 3);
+    model = A * A.adjoint();
+    gains = Eigen::VectorXcf::Ones(N) + 0.3f * Eigen::VectorXcf::Random(N);
+    Eigen::MatrixXcf noise = Eigen::MatrixXcf::Random(N, N);
+    data = gains.asDiagonal() * model * gains.adjoint().asDiagonal();
+    data += 0.01f * (noise + noise.adjoint());
+    data.diagonal().setZero();
+    model.diagonal().setZero();
+  }
+
+  bool mSupported;
+};
+
+TEST_P(GainSolverTest, KernelMatchesScalar) {
+  if (!mSupported)
+    return;
+
+  const int n = 37, stride = 48, batch = 3;
+  std::srand(7);
+  std::vector<float> P(n * batch * 2 * stride, 0.0f), g(batch * 2 * stride, 0.0f);
+  for (int j = 0; j < n * batch * 2; j++)
+    for (int p = 0; p < n; p++)
+      P[j*stride + p] = std::rand() / float(RAND_MAX) - 0.5f;
+  for (int b = 0; b < batch * 2; b++)
+    for (int p = 0; p < n; p++)
+      g[b*stride + p] = std::rand() / float(RAND_MAX) - 0.5f;
+
+  std::vector<float> expected(2 * batch * n), est(2 * batch * n);
+  gainsolve::Scalar(P.data(), g.data(), n, stride, batch, expected.data());
+  gainsolve::Select(GetParam())(P.data(), g.data(), n, stride, batch, est.data());
+  for (int i = 0; i < 2 * batch * n; i++)
+    EXPECT_NEAR(est[i], expected[i], 1e-5f) << i;
+}
+
+TEST_P(GainSolverTest, MatchesReference) {
+  if (!mSupported)
+    return;
+
+  Eigen::MatrixXcf model, data;
+  Eigen::VectorXcf gains, expected;
+  Problem(3, model, data, gains);
+  const Eigen::VectorXcf initial = Eigen::VectorXcf::Ones(N);
+  const int cycles = reference::gainSolv(model, data, initial, 10, 1e-6f, expected);
+
+  GainSolver solver(GetParam());
+  std::vector<GainSolver::Problem> batch(1, GainSolver::Problem(model, data, initial));
+  solver.Solve(batch, 10, 1e-6f);
+
+  EXPECT_NEAR(batch[0].cycles, cycles, 2);
+  EXPECT_LT((batch[0].gains - expected).norm(), 1e-4f * expected.norm());
+
+  // the gains are found up to a common phase
+  Eigen::VectorXcf g = batch[0].gains * (gains(0) / batch[0].gains(0));
+  EXPECT_LT((g - gains).norm(), 0.05f * gains.norm());
+}
+
+TEST_P(GainSolverTest, Batch) {
+  if (!mSupported)
+    return;
+
+  Eigen::MatrixXcf xx_model, xx_data, yy_model, yy_data;
+  Eigen::VectorXcf xx_gains, yy_gains;
+  Problem(4, xx_model, xx_data, xx_gains);
+  Problem(5, yy_model, yy_data, yy_gains);
+  const Eigen::VectorXcf initial = Eigen::VectorXcf::Ones(N);
+
+  GainSolver solver(GetParam());
+  std::vector<GainSolver::Problem> both;
+  both.push_back(GainSolver::Problem(xx_model, xx_data, initial));
+  both.push_back(GainSolver::Problem(yy_model, yy_data, initial));
+  solver.Solve(both, 10, 1e-6f);
+
+  for (int b = 0; b < 2; b++)
+  {
+    std::vector<GainSolver::Problem> one(1, GainSolver::Problem(*both[b].model, *both[b].data, initial));
+    solver.Solve(one, 10, 1e-6f);
+    EXPECT_EQ(one[0].cycles, both[b].cycles);
+    EXPECT_EQ(one[0].residue, both[b].residue);
+    EXPECT_TRUE(one[0].gains == both[b].gains);
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(Kernels, GainSolverTest, ValuesIn(gainsolve::Names()));
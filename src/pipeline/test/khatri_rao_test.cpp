@@ -0,0 +1,71 @@
+#include "../khatri_rao.h"
+#include "../../utils/utils.h"
+#include <gtest/gtest.h>
+
+using namespace ::testing;
+
+class KhatriRaoTest : public TestWithParam<int> {
+
+protected:
+  static const int N = 96;
+
+  KhatriRaoTest():
+    mK(N*N, GetParam())
+  {
+    std::srand(3);
+    mA = Eigen::MatrixXcf::Random(N, GetParam());
+    utils::khatrirao<std::complex<float>>(mA.conjugate(), mA, mK);
+
+    // the autocorrelations and a random tenth of the baselines are masked
+    mMask = Eigen::MatrixXf::Ones(N, N);
+    for (int i = 0; i < N; i++)
+    {
+      mMask(i, i) = 0.0f;
+      for (int j = 0; j < i; j++)
+        if (std::rand() % 10 == 0)
+          mMask(i, j) = mMask(j, i) = 0.0f;
+    }
+  }
+
+  Eigen::MatrixXcf mA;
+  Eigen::MatrixXcf mK;
+  Eigen::MatrixXf mMask;
+};
+
+TEST_P(KhatriRaoTest, Project) {
+  Eigen::MatrixXcf r = Eigen::MatrixXcf::Random(N, N);
+  Eigen::MatrixXcf R = (r + r.adjoint()).array() * mMask.array();
+
+  Eigen::VectorXcf projection;
+  khatri_rao::Project(mA, R, projection);
+
+  Eigen::MatrixXcf data = R;
+  data.resize(N*N, 1);
+  Eigen::VectorXcf expected = mK.adjoint() * data;
+  EXPECT_LT((projection - expected).cwiseAbs().maxCoeff(), 1e-4f * expected.cwiseAbs().maxCoeff());
+}
+
+TEST_P(KhatriRaoTest, Gram) {
+  Eigen::MatrixXcf gram;
+  khatri_rao::Gram(mA, std::vector<int>(), gram);
+  Eigen::MatrixXcf expected = mK.adjoint() * mK;
+  EXPECT_LT((gram - expected).cwiseAbs().maxCoeff(), 1e-4f * expected.cwiseAbs().maxCoeff());
+}
+
+TEST_P(KhatriRaoTest, MaskedGram) {
+  std::vector<int> excluded = khatri_rao::Excluded(mMask);
+  EXPECT_EQ(int(excluded.size()), (mMask.array() == 0.0f).count());
+
+  // the rows of K that remain, as walsCalibration gathered them
+  Eigen::MatrixXcf rest(N*N - excluded.size(), GetParam());
+  for (int i = 0, k = 0; i < N*N; i++)
+    if (mMask(i) > 0.5f)
+      rest.row(k++) = mK.row(i);
+
+  Eigen::MatrixXcf gram;
+  khatri_rao::Gram(mA, excluded, gram);
+  Eigen::MatrixXcf expected = rest.adjoint() * rest;
+  EXPECT_LT((gram - expected).cwiseAbs().maxCoeff(), 1e-4f * expected.cwiseAbs().maxCoeff());
+}
+
+INSTANTIATE_TEST_CASE_P(Sources, KhatriRaoTest, Values(1, 3, 5));
@@ -0,0 +1,89 @@
+#include "../packed_acm.h"
+#include <gtest/gtest.h>
+
+using namespace ::testing;
+
+class PackedACMTest : public Test {
+
+protected:
+  static const int A = 288;
+
+  PackedACMTest() {
+    Eigen::MatrixXcf r = Eigen::MatrixXcf::Random(A, A);
+    mDense = r * r.adjoint();
+    for (int i = 0; i < A; i++)
+      for (int j = 0; j <= i; j++)
+        mACM.Row(i)[j] = mDense(i, j);
+  }
+
+  Eigen::MatrixXcf mDense;
+  PackedACM<A> mACM;
+};
+
+TEST_F(PackedACMTest, Elements) {
+  for (int i = 0; i < A; i++)
+    for (int j = 0; j < A; j++)
+      EXPECT_EQ(mACM(i, j), mDense(i, j));
+
+  // baseline order of the correlator
+  EXPECT_EQ(mACM.data()[17*18/2 + 5], mDense(17, 5));
+}
+
+TEST_F(PackedACMTest, ColumnMeans) {
+  Eigen::VectorXf means;
+  mACM.ColumnMeans(means);
+  Eigen::VectorXf expected = mDense.colwise().mean().array().abs();
+  for (int i = 0; i < A; i++)
+    EXPECT_NEAR(means(i), expected(i), 1e-4f * expected(i));
+}
+
+TEST_F(PackedACMTest, ZeroAntenna) {
+  mACM.ZeroAntenna(0);
+  mACM.ZeroAntenna(100);
+  mACM.ZeroAntenna(A-1);
+  for (int i = 0; i < A; i++)
+    for (int j = 0; j < A; j++)
+    {
+      bool zero = i == 0 || j == 0 || i == 100 || j == 100 || i == A-1 || j == A-1;
+      EXPECT_EQ(mACM(i, j), zero ? std::complex<float>(0.0f) : mDense(i, j));
+    }
+}
+
+TEST_F(PackedACMTest, Dense) {
+  std::vector<int> I = {1, 2, 40, 41, 200, 287};
+  Eigen::MatrixXcf dense;
+  mACM.ToDense(I, dense);
+  ASSERT_EQ(dense.rows(), 6);
+  for (int k = 0; k < 6; k++)
+    for (int l = 0; l < 6; l++)
+      EXPECT_EQ(dense(k, l), mDense(I[k], I[l]));
+
+  mACM.SetZero();
+  mACM.FromDense(I, dense);
+  EXPECT_EQ(mACM(41, 2), mDense(41, 2));
+  EXPECT_EQ(mACM(2, 41), mDense(2, 41));
+  EXPECT_EQ(mACM(3, 2), std::complex<float>(0.0f));
+}
+
+TEST_F(PackedACMTest, DenseBlocks) {
+  // enough antennas for the mirror to cross several blocks
+  std::vector<int> I;
+  for (int i = 0; i < A; i++)
+    if (i % 7 != 3)
+      I.push_back(i);
+  Eigen::MatrixXcf dense;
+  mACM.ToDense(I, dense);
+  const int n = I.size();
+  ASSERT_EQ(dense.rows(), n);
+  for (int k = 0; k < n; k++)
+    for (int l = 0; l < n; l++)
+      EXPECT_EQ(dense(k, l), mDense(I[k], I[l]));
+}
+
+TEST_F(PackedACMTest, Sanitize) {
+  mACM.Row(10)[3] = std::complex<float>(NAN, 1.0f);
+  mACM.Row(10)[10] = std::complex<float>(2.0f, 0.5f);
+  mACM.Sanitize();
+  EXPECT_EQ(mACM(10, 3), std::complex<float>(0.0f));
+  EXPECT_EQ(mACM(10, 10), std::complex<float>(2.0f, 0.0f));
+}
@@ -0,0 +1,116 @@
+#include "../reduction.h"
+#include "../../config.h"
+#include <gtest/gtest.h>
+#include <random>
+
+using namespace ::testing;
+
+class ReductionTest : public TestWithParam<int> {
+
+protected:
+  virtual void SetUp() {
+    mAntennas = GetParam();
+    mBaselines = mAntennas*(mAntennas+1)/2;
+    int stations = mAntennas/NUM_ANTENNAS_PER_STATION;
+
+    std::mt19937 gen(42);
+    std::normal_distribution<float> normal(1.0f, 0.5f);
+    mVis.resize(NUM_CHANNELS, mBaselines);
+    for (int i = 0; i < mVis.size(); i++)
+      mVis(i) = std::complex<float>(normal(gen), normal(gen));
+    mWeights.resize(stations*(stations+1)/2);
+    for (int i = 0; i < mWeights.size(); i++)
+      mWeights(i) = 0.5f + 0.01f*i;
+
+    // the weighted visibilities, as the Weighter used to write them
+    mWeighted = mVis;
+    for (int a0 = 0, b = 0; a0 < mAntennas; a0++)
+      for (int a1 = 0; a1 <= a0; a1++, b++)
+      {
+        int s0 = a0/NUM_ANTENNAS_PER_STATION, s1 = a1/NUM_ANTENNAS_PER_STATION;
+        mWeighted.col(b) *= mWeights(s0*(s0+1)/2 + s1);
+      }
+  }
+
+  int mAntennas;
+  int mBaselines;
+  Eigen::MatrixXcf mVis;
+  Eigen::MatrixXcf mWeighted;
+  Eigen::VectorXf mWeights;
+};
+
+TEST_P(ReductionTest, ChannelSums) {
+  Eigen::VectorXcd sums(NUM_CHANNELS);
+  reduction::ChannelSums(mVis.data(), mAntennas, NUM_CHANNELS, mWeights.data(), nullptr, sums.data());
+
+  Eigen::VectorXcd expected = mWeighted.cast<std::complex<double>>().rowwise().sum();
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    EXPECT_NEAR(std::abs(sums(c) - expected(c)), 0.0, 1e-6*std::abs(expected(c)));
+}
+
+TEST_P(ReductionTest, MaskedMeans) {
+  Eigen::VectorXf mask = Eigen::VectorXf::Ones(NUM_CHANNELS);
+  mask(0) = mask(17) = mask(NUM_CHANNELS-1) = 0.0f;
+  Eigen::VectorXcf means(mBaselines);
+  reduction::MaskedMeans(mVis.data(), mAntennas, NUM_CHANNELS, mWeights.data(), nullptr, mask.data(), nullptr, means.data());
+
+  Eigen::MatrixXcf masked = mWeighted.array().colwise() * mask.cast<std::complex<float>>().array();
+  Eigen::VectorXcf expected = masked.colwise().sum().transpose() / mask.sum();
+  for (int b = 0; b < mBaselines; b++)
+    EXPECT_NEAR(std::abs(means(b) - expected(b)), 0.0f, 1e-5f*std::abs(expected(b)));
+}
+
+TEST_P(ReductionTest, Flagged) {
+  Eigen::VectorXf mask = Eigen::VectorXf::Ones(NUM_CHANNELS);
+  mask(3) = 0.0f;
+  std::vector<uint64_t> flags(mBaselines, 0);
+  Eigen::MatrixXf used = mask.replicate(1, mBaselines);
+  for (int b = 1; b < mBaselines; b += 7)
+  {
+    // channel 3 is masked already and does not count twice
+    flags[b] = (uint64_t(1) << 3) | (uint64_t(1) << (b % NUM_CHANNELS));
+    mVis(b % NUM_CHANNELS, b) = 0.0f;
+    mWeighted(b % NUM_CHANNELS, b) = 0.0f;
+    used(b % NUM_CHANNELS, b) = 0.0f;
+  }
+  Eigen::VectorXcf means(mBaselines);
+  reduction::MaskedMeans(mVis.data(), mAntennas, NUM_CHANNELS, mWeights.data(), nullptr, mask.data(), flags.data(), means.data());
+
+  Eigen::MatrixXcf masked = mWeighted.array().colwise() * mask.cast<std::complex<float>>().array();
+  Eigen::VectorXcf expected = masked.colwise().sum().transpose().array() / used.colwise().sum().transpose().array();
+  for (int b = 0; b < mBaselines; b++)
+    EXPECT_NEAR(std::abs(means(b) - expected(b)), 0.0f, 1e-5f*std::abs(expected(b)));
+}
+
+TEST_P(ReductionTest, Skipped) {
+  std::vector<uint8_t> skip(mAntennas, 0);
+  skip[0] = skip[7] = skip[mAntennas-1] = 1;
+  for (int a0 = 0, b = 0; a0 < mAntennas; a0++)
+    for (int a1 = 0; a1 <= a0; a1++, b++)
+      if (skip[a0] || skip[a1])
+        mWeighted.col(b).setZero();
+
+  Eigen::VectorXcd sums(NUM_CHANNELS);
+  reduction::ChannelSums(mVis.data(), mAntennas, NUM_CHANNELS, mWeights.data(), skip.data(), sums.data());
+  Eigen::VectorXcd expected = mWeighted.cast<std::complex<double>>().rowwise().sum();
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    EXPECT_NEAR(std::abs(sums(c) - expected(c)), 0.0, 1e-6*std::abs(expected(c)));
+
+  Eigen::VectorXf mask = Eigen::VectorXf::Ones(NUM_CHANNELS);
+  Eigen::VectorXcf means(mBaselines);
+  reduction::MaskedMeans(mVis.data(), mAntennas, NUM_CHANNELS, mWeights.data(), skip.data(), mask.data(), nullptr, means.data());
+  Eigen::VectorXcf result = mWeighted.colwise().sum().transpose() / float(NUM_CHANNELS);
+  for (int b = 0; b < mBaselines; b++)
+    EXPECT_NEAR(std::abs(means(b) - result(b)), 0.0f, 1e-5f*std::abs(result(b)));
+}
+
+TEST_P(ReductionTest, AllMasked) {
+  Eigen::VectorXf mask = Eigen::VectorXf::Zero(NUM_CHANNELS);
+  Eigen::VectorXcf means(mBaselines);
+  reduction::MaskedMeans(mVis.data(), mAntennas, NUM_CHANNELS, mWeights.data(), nullptr, mask.data(), nullptr, means.data());
+
+  for (int b = 0; b < mBaselines; b += 101)
+    EXPECT_TRUE(std::isnan(means(b).real()));
+}
+
+INSTANTIATE_TEST_CASE_P(Antennas, ReductionTest, Values(288, 576));
@@ -0,0 +1,67 @@
+#include "../subspace.h"
+#include <gtest/gtest.h>
+
+using namespace ::testing;
+using namespace Eigen;
+
+class SubspaceTest : public Test {
+
+protected:
+  static const int N = 288;
+
+  /// A whitened acm: a few strong sources on top of unit noise
+  SubspaceTest() {
+    std::srand(3);
+    MatrixXcf A = MatrixXcf::Random(N, 3);
+    VectorXf flux(3);
+    flux << 2.0f, 0.6f, 0.1f;
+    MatrixXcf noise = MatrixXcf::Random(N, N) * 0.05f;
+    mR = A * flux.cast<std::complex<float>>().asDiagonal() * A.adjoint();
+    mR += noise + noise.adjoint();
+    mR += MatrixXcf::Identity(N, N);
+  }
+
+  /// Smallest cosine of the angles between the first k columns of U and V
+  static float Alignment(const MatrixXcf &U, const MatrixXcf &V, const int k) {
+    JacobiSVD<MatrixXcf> svd(U.leftCols(k).adjoint() * V.leftCols(k));
+    return svd.singularValues().minCoeff();
+  }
+
+  MatrixXcf mR;
+};
+
+TEST_F(SubspaceTest, Dominant) {
+  SelfAdjointEigenSolver<MatrixXcf> full(mR);
+  MatrixXcf E = full.eigenvectors().rightCols(3).rowwise().reverse();
+  VectorXf e = full.eigenvalues().tail(3).reverse();
+
+  MatrixXcf Q;
+  VectorXf values;
+  int iterations = subspace::Dominant(mR, 3, Q, values);
+  ASSERT_GT(iterations, 0);
+  for (int i = 0; i < 3; i++)
+    EXPECT_NEAR(values(i), e(i), 1e-3f * e(0));
+  EXPECT_GT(Alignment(Q, E, 3), 0.999f);
+}
+
+TEST_F(SubspaceTest, WarmStart) {
+  MatrixXcf Q;
+  VectorXf values;
+  int cold = subspace::Dominant(mR, 3, Q, values);
+
+  // the next integration barely differs
+  MatrixXcf next = mR;
+  next.diagonal().array() += 0.01f;
+  MatrixXcf W = Q;
+  int warm = subspace::Dominant(next, 3, W, values);
+  ASSERT_GT(warm, 0);
+  EXPECT_LT(warm, cold);
+  EXPECT_GT(Alignment(Q, W, 3), 0.999f);
+}
+
+TEST_F(SubspaceTest, NotConverged) {
+  MatrixXcf Q;
+  VectorXf values;
+  EXPECT_EQ(subspace::Dominant(mR, 3, Q, values, 1e-4f, 1), -1);
+  EXPECT_EQ(Q.cols(), 7);
+}
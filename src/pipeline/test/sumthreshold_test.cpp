@@ -0,0 +1,237 @@
+#include "../sumthreshold.h"
+#include "../rfi_flagger.h"
+#include "../../config.h"
+#include <gtest/gtest.h>
+#include <thread>
+#include <random>
+
+using namespace ::testing;
+
+/// Amplitude standard deviation of the noise, as Normalize estimates it
+#define NOISE 0.1f
+
+class SumThresholdTest : public Test {
+
+protected:
+  virtual void SetUp() {
+    mGen.seed(42);
+  }
+
+  /// A baseline of unit amplitude with gaussian noise
+  void Baseline(std::complex<float> *vis, const int n = NUM_CHANNELS) {
+    std::normal_distribution<float> normal(0.0f, NOISE);
+    for (int c = 0; c < n; c++)
+      vis[c] = std::complex<float>(1.0f + normal(mGen), normal(mGen));
+  }
+
+  uint64_t Flag(const std::complex<float> *vis, const int n = NUM_CHANNELS) {
+    float z[64];
+    sumthreshold::Normalize(vis, n, z);
+    return sumthreshold::Frequency(z, n, 6.0f);
+  }
+
+  std::mt19937 mGen;
+};
+
+TEST_F(SumThresholdTest, Constant) {
+  std::complex<float> vis[NUM_CHANNELS];
+  float z[NUM_CHANNELS];
+  std::fill(vis, vis + NUM_CHANNELS, std::complex<float>(2.0f, 1.0f));
+  sumthreshold::Normalize(vis, NUM_CHANNELS, z);
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    EXPECT_EQ(z[c], 0.0f);
+  EXPECT_EQ(sumthreshold::Frequency(z, NUM_CHANNELS, 6.0f), 0u);
+}
+
+TEST_F(SumThresholdTest, Noise) {
+  std::complex<float> vis[NUM_CHANNELS];
+  int flagged = 0;
+  for (int i = 0; i < 10000; i++)
+  {
+    Baseline(vis);
+    flagged += __builtin_popcountll(Flag(vis));
+  }
+  EXPECT_LT(flagged, 10000*NUM_CHANNELS/1000);
+}
+
+TEST_F(SumThresholdTest, Spike) {
+  std::complex<float> vis[NUM_CHANNELS];
+  for (int i = 0; i < 100; i++)
+  {
+    Baseline(vis);
+    vis[17] += 10.0f*NOISE;
+    EXPECT_EQ(Flag(vis), uint64_t(1) << 17);
+  }
+}
+
+TEST_F(SumThresholdTest, Broad) {
+  std::complex<float> vis[NUM_CHANNELS];
+  for (int i = 0; i < 100; i++)
+  {
+    // mostly too weak for a single channel
+    Baseline(vis);
+    for (int c = 40; c < 48; c++)
+      vis[c] += 4.0f*NOISE;
+    uint64_t flags = Flag(vis);
+    // flagged channels count at the threshold, a weak edge may be missed
+    EXPECT_GE(__builtin_popcountll(flags & (uint64_t(0xff) << 40)), 6);
+    // at most the rest of a window of 16 channels
+    EXPECT_EQ(flags & ~(uint64_t(0xffffff) << 32), 0u);
+  }
+}
+
+TEST_F(SumThresholdTest, FewChannels) {
+  std::complex<float> vis[5];
+  Baseline(vis, 5);
+  vis[4] += 100.0f*NOISE;
+  EXPECT_EQ(Flag(vis, 5), uint64_t(1) << 4);
+}
+
+TEST_F(SumThresholdTest, Time) {
+  std::complex<float> vis[NUM_CHANNELS];
+  float z[NUM_CHANNELS];
+  sumthreshold::Sample history[4][NUM_CHANNELS];
+  const sumthreshold::Sample *past[3] = {history[2], history[1], history[0]};
+
+  // a channel slightly above the noise in four integrations
+  for (int t = 0; t < 4; t++)
+  {
+    Baseline(vis);
+    vis[30] += 4.0f*NOISE;
+    sumthreshold::Normalize(vis, NUM_CHANNELS, z);
+    uint64_t flags = sumthreshold::Frequency(z, NUM_CHANNELS, 6.0f);
+    EXPECT_EQ(flags & (uint64_t(1) << 30), 0u);
+    sumthreshold::Quantize(z, NUM_CHANNELS, flags, history[t]);
+    if (t == 3)
+      EXPECT_EQ(sumthreshold::Time(z, past, 3, NUM_CHANNELS, 6.0f, flags), uint64_t(1) << 30);
+  }
+
+  // a strong spike in the past is flagged there and does not flag the present
+  std::fill(z, z + NUM_CHANNELS, 0.0f);
+  sumthreshold::Quantize(z, NUM_CHANNELS, 0, history[0]);
+  sumthreshold::Quantize(z, NUM_CHANNELS, 0, history[1]);
+  z[5] = 20.0f;
+  sumthreshold::Quantize(z, NUM_CHANNELS, uint64_t(1) << 5, history[2]);
+  z[5] = 2.0f;
+  EXPECT_EQ(sumthreshold::Time(z, past, 3, NUM_CHANNELS, 6.0f, 0), 0u);
+}
+
+class RFIFlaggerTest : public SumThresholdTest {
+
+protected:
+  static const int A = 288;
+
+  /// An integration with a narrow band transmitter on every 50th baseline
+  void Integration(std::vector<std::complex<float>> &vis) {
+    vis.resize(Config<A>::NUM_BASELINES*NUM_CHANNELS);
+    for (int b = 0; b < Config<A>::NUM_BASELINES; b++)
+    {
+      Baseline(&vis[b*NUM_CHANNELS]);
+      if (b % 50 == 0)
+        vis[b*NUM_CHANNELS + 11] += 20.0f*NOISE;
+    }
+  }
+};
+
+TEST_F(RFIFlaggerTest, Flags) {
+  std::vector<std::complex<float>> vis;
+  Integration(vis);
+  RFIFlagger<A> flagger(6.0f, 3, {});
+  std::vector<uint64_t> flagged(Config<A>::NUM_BASELINES);
+  int count = flagger.Run(vis.data(), NUM_CHANNELS, 0, 0.0, 1.0, flagged.data());
+
+  int transmitter = 0, expected = 0;
+  for (int i = 0, b = 0; i < A; i++)
+    for (int j = 0; j <= i; j++, b++)
+    {
+      uint64_t flags = flagged[b];
+      if (i == j)
+        EXPECT_EQ(flags, 0u);
+      else if (b % 50 == 0)
+      {
+        expected++;
+        transmitter += (flags >> 11) & 1;
+      }
+
+      for (int c = 0; c < NUM_CHANNELS; c++)
+        if ((flags >> c) & 1)
+          EXPECT_EQ(vis[b*NUM_CHANNELS + c], std::complex<float>(0.0f, 0.0f));
+    }
+
+  EXPECT_EQ(transmitter, expected);
+  EXPECT_LT(count, 2*transmitter);
+}
+
+TEST_F(RFIFlaggerTest, Threads) {
+  std::vector<std::complex<float>> single, threaded;
+  std::vector<uint64_t> fa(Config<A>::NUM_BASELINES), fb(Config<A>::NUM_BASELINES);
+  RFIFlagger<A> a(6.0f, 3, {});
+  RFIFlagger<A> b(6.0f, 3, {0, 0, 0});
+
+  for (int t = 0; t < 5; t++)
+  {
+    Integration(single);
+    threaded = single;
+    EXPECT_EQ(a.Run(single.data(), NUM_CHANNELS, 1, t, t + 1.0, fa.data()), b.Run(threaded.data(), NUM_CHANNELS, 1, t, t + 1.0, fb.data()));
+    EXPECT_TRUE(single == threaded);
+    EXPECT_TRUE(fa == fb);
+  }
+}
+
+TEST_F(RFIFlaggerTest, Callers) {
+  // two processing threads flag both keys at once and swap keys every
+  // integration, the history of a key follows it from thread to thread
+  const int T = 6;
+  std::vector<std::vector<std::complex<float>>> single(2*T), shared(2*T);
+  for (int i = 0; i < 2*T; i++)
+  {
+    Integration(single[i]);
+    shared[i] = single[i];
+  }
+
+  RFIFlagger<A> a(6.0f, 3, {});
+  std::vector<uint64_t> flags(Config<A>::NUM_BASELINES);
+  std::vector<int> expected(2*T), counts(2*T);
+  for (int i = 0; i < 2*T; i++)
+    expected[i] = a.Run(single[i].data(), NUM_CHANNELS, i % 2, i / 2, i / 2 + 1.0, flags.data());
+
+  RFIFlagger<A> b(6.0f, 3, {0});
+  std::vector<uint64_t> fx(Config<A>::NUM_BASELINES), fy(Config<A>::NUM_BASELINES);
+  auto run = [&](const int i, std::vector<uint64_t> &f)
+  {
+    counts[i] = b.Run(shared[i].data(), NUM_CHANNELS, i % 2, i / 2, i / 2 + 1.0, f.data());
+  };
+  for (int t = 0; t < T; t++)
+  {
+    std::thread x(run, 2*t + t % 2, std::ref(fx));
+    std::thread y(run, 2*t + 1 - t % 2, std::ref(fy));
+    x.join();
+    y.join();
+  }
+
+  EXPECT_TRUE(counts == expected);
+  EXPECT_TRUE(single == shared);
+}
+
+TEST_F(RFIFlaggerTest, OutOfOrder) {
+  // an integration older than the last one of its key leaves the history alone
+  std::vector<std::complex<float>> a0, a1, a2, b0, b1, b2, late;
+  std::vector<uint64_t> flags(Config<A>::NUM_BASELINES);
+  Integration(a0);
+  Integration(a1);
+  Integration(a2);
+  Integration(late);
+  b0 = a0;
+  b1 = a1;
+  b2 = a2;
+
+  RFIFlagger<A> a(6.0f, 3, {}), b(6.0f, 3, {});
+  a.Run(a0.data(), NUM_CHANNELS, 0, 0.0, 1.0, flags.data());
+  a.Run(a1.data(), NUM_CHANNELS, 0, 1.0, 2.0, flags.data());
+  b.Run(b0.data(), NUM_CHANNELS, 0, 0.0, 1.0, flags.data());
+  b.Run(b1.data(), NUM_CHANNELS, 0, 1.0, 2.0, flags.data());
+  b.Run(late.data(), NUM_CHANNELS, 0, 0.0, 1.0, flags.data());
+
+  EXPECT_EQ(a.Run(a2.data(), NUM_CHANNELS, 0, 2.0, 3.0, flags.data()), b.Run(b2.data(), NUM_CHANNELS, 0, 2.0, 3.0, flags.data()));
+  EXPECT_TRUE(a2 == b2);
+}
@@ -0,0 +1,136 @@
+#include "../wsf_cost.h"
+#include <gtest/gtest.h>
+
+using namespace ::testing;
+using namespace Eigen;
+
+class WSFCostTest : public TestWithParam<int> {
+
+protected:
+  static const int N = 288;
+
+  WSFCostTest():
+    mNumSources(GetParam()),
+    mFrequency(58e6)
+  {
+    std::srand(7);
+    mP = MatrixXd::Random(N, 3) * 150.0;
+    mP.col(2) *= 0.01;
+
+    // orthonormal signal subspace of a random hermitian matrix
+    MatrixXcf r = MatrixXcf::Random(N, N);
+    SelfAdjointEigenSolver<MatrixXcf> solver(r * r.adjoint());
+    mEs = solver.eigenvectors().rightCols(mNumSources);
+    mW = VectorXf::Random(mNumSources).array().abs() + 0.5f;
+    mG = VectorXcf::Random(N).array() + std::complex<float>(1.0f, 0.0f);
+  }
+
+  /// Replaces the signal subspace with the span of the response of sources in theta, a perfect fit
+  void Fit(const VectorXd &theta) {
+    const int n = mNumSources;
+    MatrixXd src_pos(n, 3);
+    src_pos.col(0) = theta.head(n).array().cos() * theta.tail(n).array().cos();
+    src_pos.col(1) = theta.head(n).array().sin() * theta.tail(n).array().cos();
+    src_pos.col(2) = theta.tail(n).array().sin();
+
+    std::complex<double> i1(0.0, 2.0 * M_PI * mFrequency / 299792458.0f);
+    MatrixXcf T = (-i1 * (mP * src_pos.transpose())).array().exp().cast<std::complex<float>>();
+    MatrixXcf A = mG.asDiagonal() * T;
+    HouseholderQR<MatrixXcf> qr(A);
+    mEs = qr.householderQ() * MatrixXcf::Identity(N, n);
+  }
+
+  /// The cost with the dense projector, as the Calibrator used to compute it
+  float Dense(const VectorXd &theta) {
+    const int n = mNumSources;
+    MatrixXd src_pos(n, 3);
+    src_pos.col(0) = theta.head(n).array().cos() * theta.tail(n).array().cos();
+    src_pos.col(1) = theta.head(n).array().sin() * theta.tail(n).array().cos();
+    src_pos.col(2) = theta.tail(n).array().sin();
+
+    std::complex<double> i1(0.0, 2.0 * M_PI * mFrequency / 299792458.0f);
+    MatrixXcf T = (-i1 * (mP * src_pos.transpose())).array().exp().cast<std::complex<float>>();
+    MatrixXcf A = mG.asDiagonal().toDenseMatrix() * T;
+    MatrixXcf EsWEs = mEs * mW.cast<std::complex<float>>().asDiagonal() * mEs.adjoint();
+    MatrixXcf PAperp = MatrixXcf::Identity(N, N).array() - (A * (A.adjoint() * A).lu().solve(A.adjoint())).array();
+    return (PAperp * EsWEs).trace().real();
+  }
+
+  int mNumSources;
+  double mFrequency;
+  MatrixXd mP;
+  MatrixXcf mEs;
+  VectorXf mW;
+  VectorXcf mG;
+};
+
+TEST_P(WSFCostTest, Equivalent) {
+  WSFCost cost(mEs, mW, mG, mFrequency, mP);
+  for (int k = 0; k < 20; k++)
+  {
+    VectorXd theta(2*mNumSources);
+    theta.head(mNumSources) = VectorXd::Random(mNumSources) * M_PI;
+    theta.tail(mNumSources) = (VectorXd::Random(mNumSources).array() * 0.5 + 0.5) * M_PI / 2.0;
+
+    float expected = Dense(theta);
+    EXPECT_NEAR(cost(theta), expected, 1e-4f * mW.sum()) << "theta " << theta.transpose();
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(Sources, WSFCostTest, Values(1, 2, 3, 5));
+
+TEST_P(WSFCostTest, Gradient) {
+  WSFCost cost(mEs, mW, mG, mFrequency, mP);
+  const double h = 1e-4;
+  for (int k = 0; k < 10; k++)
+  {
+    VectorXd theta(2*mNumSources), gradient;
+    MatrixXd hessian;
+    theta.head(mNumSources) = VectorXd::Random(mNumSources) * M_PI;
+    theta.tail(mNumSources) = (VectorXd::Random(mNumSources).array() * 0.5 + 0.5) * M_PI / 2.0;
+
+    float value = cost(theta, gradient, hessian);
+    EXPECT_FLOAT_EQ(value, cost(theta));
+    ASSERT_EQ(gradient.size(), 2*mNumSources);
+
+    // against central differences, the cost varies on the scale of the array resolution
+    for (int i = 0; i < 2*mNumSources; i++)
+    {
+      VectorXd up = theta, down = theta;
+      up(i) += h;
+      down(i) -= h;
+      double expected = (cost(up) - cost(down)) / (2.0 * h);
+      EXPECT_NEAR(gradient(i), expected, 0.02 * (std::abs(expected) + mW.sum())) << "parameter " << i;
+    }
+  }
+}
+
+TEST_P(WSFCostTest, Hessian) {
+  VectorXd theta(2*mNumSources);
+  theta.head(mNumSources) = VectorXd::Random(mNumSources) * M_PI;
+  theta.tail(mNumSources) = (VectorXd::Random(mNumSources).array() * 0.25 + 0.5) * M_PI / 2.0;
+  Fit(theta);
+  mP.rowwise() += RowVector3d(3826577.0, 461022.0, 5064892.0);
+
+  // where the sources fit the subspace the residual vanishes and with it
+  // the part of the hessian the approximation drops
+  WSFCost cost(mEs, mW, mG, mFrequency, mP);
+  VectorXd gradient;
+  MatrixXd hessian;
+  float value = cost(theta, gradient, hessian);
+  EXPECT_NEAR(value, 0.0f, 1e-3f * mW.sum());
+  EXPECT_LT(gradient.lpNorm<Infinity>(), 1e-2 * hessian.diagonal().maxCoeff());
+
+  const double h = 1e-4;
+  for (int i = 0; i < 2*mNumSources; i++)
+  {
+    VectorXd up = theta, down = theta, gu, gd;
+    MatrixXd hu, hd;
+    up(i) += h;
+    down(i) -= h;
+    cost(up, gu, hu);
+    cost(down, gd, hd);
+    VectorXd expected = (gu - gd) / (2.0 * h);
+    EXPECT_LT((hessian.col(i) - expected).lpNorm<Infinity>(), 0.02 * hessian.diagonal().maxCoeff()) << "parameter " << i;
+  }
+}
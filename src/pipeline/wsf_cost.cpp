@@ -0,0 +1,75 @@
+#include "wsf_cost.h"
+
+#include <cmath>
+
+#define C_MS 299792458.0f
+
+WSFCost::WSFCost(const Eigen::MatrixXcf &Es, const Eigen::VectorXf &w, const Eigen::VectorXcf &g, const double freq, const Eigen::MatrixXd &P):
+  mEs(Es),
+  mW(w),
+  mG(g),
+  mP(P),
+  mNumSources(w.size()),
+  mK(0.0, -2.0 * M_PI * freq / C_MS),
+  mCentre(P.colwise().mean()),
+  mTraceW(w.sum())
+{
+  mSrcPos.resize(mNumSources, 3);
+  mA.resize(P.rows(), mNumSources);
+}
+
+float WSFCost::operator()(const Eigen::VectorXd &theta)
+{
+  const int n = mNumSources;
+  mSrcPos.col(0) = theta.head(n).array().cos() * theta.tail(n).array().cos();
+  mSrcPos.col(1) = theta.head(n).array().sin() * theta.tail(n).array().cos();
+  mSrcPos.col(2) = theta.tail(n).array().sin();
+
+  mA = (mK * (mP * mSrcPos.transpose())).array().exp().cast<std::complex<float>>();
+  mA = mG.asDiagonal() * mA;
+
+  mAA.noalias() = mA.adjoint() * mA;
+  mB.noalias() = mEs.adjoint() * mA;
+  mWB.noalias() = mW.cast<std::complex<float>>().asDiagonal() * mB;
+  Eigen::MatrixXcf BWB = mB.adjoint() * mWB;
+
+  return mTraceW - mAA.lu().solve(BWB).trace().real();
+}
+
+float WSFCost::operator()(const Eigen::VectorXd &theta, Eigen::VectorXd &gradient, Eigen::MatrixXd &hessian)
+{
+  const int n = mNumSources;
+  const float cost = (*this)(theta);
+
+  Eigen::MatrixXcf X = mAA.inverse();
+  Eigen::MatrixXcf XCX = X * (mB.adjoint() * mWB) * X;
+  mGA.noalias() = mEs * (mWB * X);
+  mGA.noalias() -= mA * XCX;
+
+  // derivatives of the response to the longitudes and then the latitudes,
+  // dA(:,k) = A(:,k) K P ds_k
+  Eigen::MatrixXd ds(3, 2*n);
+  for (int k = 0; k < n; k++)
+  {
+    const double cl = cos(theta(k)), sl = sin(theta(k));
+    const double cb = cos(theta(n+k)), sb = sin(theta(n+k));
+    ds.col(k) << -sl * cb, cl * cb, 0.0;
+    ds.col(n+k) << -cl * sb, -sl * sb, cb;
+  }
+  mD = (mK * ((mP.rowwise() - mCentre) * ds)).cast<std::complex<float>>();
+  for (int i = 0; i < 2*n; i++)
+    mD.col(i).array() *= mA.col(i % n).array();
+
+  gradient.resize(2*n);
+  for (int i = 0; i < 2*n; i++)
+    gradient(i) = -2.0 * mD.col(i).dot(mGA.col(i % n)).real();
+
+  Eigen::MatrixXcf PD = mD - mA * (X * (mA.adjoint() * mD));
+  Eigen::MatrixXcf DPD = mD.adjoint() * PD;
+  hessian.resize(2*n, 2*n);
+  for (int i = 0; i < 2*n; i++)
+    for (int j = 0; j < 2*n; j++)
+      hessian(i, j) = 2.0 * (DPD(i, j) * XCX(j % n, i % n)).real();
+
+  return cost;
+}
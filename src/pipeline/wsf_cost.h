@@ -0,0 +1,66 @@
+#pragma once
+
+#include <Eigen/Dense>
+
+/**
+ * Weighted subspace fitting cost of nsrc source directions, as minimized by
+ * the simplex of the Calibrator. With the array response A = diag(g) T of the
+ * directions and the weighted signal subspace Es W Es^H the cost is
+ *
+ *   trace(P_A^perp Es W Es^H) = trace(W) - trace((A^H A)^-1 B^H W B), B = Es^H A
+ *
+ * which needs A^H A and B, both nsrc x nsrc, instead of the dense N x N
+ * projector. An evaluation is O(N nsrc^2). With X = (A^H A)^-1 and
+ * C = B^H W B the derivative to a perturbation dA of the response is
+ *
+ *   -2 Re trace(dA^H (Es W B X - A X C X))
+ *
+ * and a column of A only depends on the direction of its own source. With D
+ * the derivatives of the columns the hessian is approximated by
+ *
+ *   2 Re(D^H P_A^perp D .* (X C X)^T)
+ *
+ * as in the scoring method of Viberg and Ottersten, both cost another
+ * O(N nsrc^2). The cost does not change with the phase of a column, so the
+ * derivatives use positions relative to the centre of the array, itrf
+ * positions are too large for the sums in floats.
+ */
+class WSFCost
+{
+public:
+  /**
+   * @brief
+   * Es holds the nsrc dominant eigenvectors of the data, w their weights,
+   * g the complex gains and P the itrf antenna positions.
+   */
+  WSFCost(const Eigen::MatrixXcf &Es, const Eigen::VectorXf &w, const Eigen::VectorXcf &g, const double freq, const Eigen::MatrixXd &P);
+
+  /// theta holds the longitudes of the sources followed by their latitudes
+  float operator()(const Eigen::VectorXd &theta);
+
+  /**
+   * @brief
+   * The cost with its derivatives to the longitudes and latitudes, hessian
+   * is the Gauss-Newton approximation that drops the second derivatives of
+   * the response.
+   */
+  float operator()(const Eigen::VectorXd &theta, Eigen::VectorXd &gradient, Eigen::MatrixXd &hessian);
+
+private:
+  const Eigen::MatrixXcf &mEs;
+  const Eigen::VectorXf &mW;
+  const Eigen::VectorXcf &mG;
+  const Eigen::MatrixXd &mP;
+  const int mNumSources;
+  std::complex<double> mK;
+  Eigen::RowVector3d mCentre;
+  float mTraceW;
+
+  Eigen::MatrixXd mSrcPos;
+  Eigen::MatrixXcf mA;
+  Eigen::MatrixXcf mB;
+  Eigen::MatrixXcf mAA;
+  Eigen::MatrixXcf mWB;
+  Eigen::MatrixXcf mGA;
+  Eigen::MatrixXcf mD;
+};
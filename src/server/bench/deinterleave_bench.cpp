@@ -0,0 +1,60 @@
+#include "../deinterleave.h"
+#include "../packet.h"
+#include <benchmark/benchmark.h>
+#include <pipeline/output_module_interface.h>
+
+static void BM_Deinterleave(benchmark::State &state, const std::string &name)
+{
+  if (!deinterleave::Supported(name))
+  {
+    state.SkipWithError("kernel not supported by this cpu");
+    return;
+  }
+
+  auto kernel = deinterleave::Select(name);
+  const std::size_t chunk = 166464;
+  const std::size_t n = 41616*63*2*8;
+  Datum src(chunk, 1);
+  Datum xx(sizeof(output_header_t) + n/2);
+  Datum yy(sizeof(output_header_t) + n/2);
+
+  for (auto _ : state)
+  {
+    for (std::size_t i = 0; i < n; i += chunk)
+      kernel(src.data(), chunk, xx.data() + sizeof(output_header_t) + i/2, yy.data() + sizeof(output_header_t) + i/2);
+    benchmark::ClobberMemory();
+  }
+
+  state.SetBytesProcessed(int64_t(state.iterations()) * n);
+}
+
+/// De-interleaves only the first range(0) channels of every baseline
+static void BM_DeinterleaveSelected(benchmark::State &state)
+{
+  const deinterleave::Ranges ranges = {{0, int(state.range(0)) - 1}};
+  const std::size_t chunk = 166464;
+  const std::size_t n = 41616*63*2*8;
+  Datum src(chunk, 1);
+  Datum xx(sizeof(output_header_t) + n/2);
+  Datum yy(sizeof(output_header_t) + n/2);
+
+  for (auto _ : state)
+  {
+    std::size_t out = 0;
+    for (std::size_t i = 0; i < n; i += chunk)
+      out += deinterleave::Selected(src.data(), chunk, 63, (i/16) % 63, ranges,
+                                    xx.data() + sizeof(output_header_t) + out, yy.data() + sizeof(output_header_t) + out);
+    benchmark::ClobberMemory();
+  }
+
+  state.SetBytesProcessed(int64_t(state.iterations()) * n);
+}
+
+BENCHMARK_CAPTURE(BM_Deinterleave, scalar, std::string("scalar"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Deinterleave, sse4, std::string("sse4"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Deinterleave, avx2, std::string("avx2"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Deinterleave, avx512, std::string("avx512"))->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_DeinterleaveSelected)->Arg(63)->Arg(32)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,114 @@
+#include "../uring_receiver.h"
+#include <benchmark/benchmark.h>
+#include <boost/asio.hpp>
+#include <atomic>
+#include <poll.h>
+#include <thread>
+#include <unistd.h>
+
+using boost::asio::ip::tcp;
+
+/// Payload of one 288 antenna integration
+static const std::size_t n = 41616*63*2*8;
+
+/// Connected loopback TCP pair, the client side sends as fast as it can
+class Loopback
+{
+public:
+  Loopback():
+    mAcceptor(mIoService, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0)),
+    mServer(mIoService),
+    mClient(mIoService),
+    mRunning(true)
+  {
+    mClient.connect(mAcceptor.local_endpoint());
+    mAcceptor.accept(mServer);
+    mSender = std::thread([this]() {
+      std::vector<uint8_t> data(1 << 20, 1);
+      boost::system::error_code ec;
+      while (mRunning && !ec)
+        boost::asio::write(mClient, boost::asio::buffer(data), ec);
+    });
+  }
+
+  ~Loopback()
+  {
+    mRunning = false;
+    boost::system::error_code ec;
+    mClient.shutdown(tcp::socket::shutdown_both, ec);
+    mSender.join();
+  }
+
+  boost::asio::io_service mIoService;
+  tcp::acceptor mAcceptor;
+  tcp::socket mServer;
+  tcp::socket mClient;
+  std::atomic<bool> mRunning;
+  std::thread mSender;
+};
+
+static void BM_IngestAsio(benchmark::State &state)
+{
+  const std::size_t b = state.range(0);
+  Loopback loopback;
+  std::vector<uint8_t> buffer(b);
+  std::size_t received = 0;
+
+  // one async_read per chunk, like Stream::ReadChunk
+  std::function<void(boost::system::error_code, std::size_t)> handler;
+  handler = [&](boost::system::error_code ec, std::size_t length) {
+    received += length;
+    if (!ec && received < n)
+      boost::asio::async_read(loopback.mServer, boost::asio::buffer(buffer), handler);
+  };
+
+  for (auto _ : state)
+  {
+    received = 0;
+    boost::asio::async_read(loopback.mServer, boost::asio::buffer(buffer), handler);
+    loopback.mIoService.run();
+    loopback.mIoService.reset();
+  }
+
+  state.SetBytesProcessed(int64_t(state.iterations()) * n);
+}
+
+static void BM_IngestUring(benchmark::State &state)
+{
+  const std::size_t b = state.range(0);
+  Loopback loopback;
+  std::size_t received = 0;
+  uint64_t submits = 0;
+
+  {
+    UringReceiver receiver(loopback.mServer.native_handle(), b, 16);
+    receiver.Start([b]() { return b; });
+
+    for (auto _ : state)
+    {
+      uint64_t start = receiver.Submits();
+      for (received = 0; received < n;)
+      {
+        pollfd fd = {receiver.EventFd(), POLLIN, 0};
+        poll(&fd, 1, -1);
+        uint64_t events;
+        if (read(receiver.EventFd(), &events, sizeof(events)) < 0)
+          continue;
+        if (!receiver.Reap([&](const uint8_t*, std::size_t length) { received += length; }))
+        {
+          state.SkipWithError("stream ended");
+          return;
+        }
+      }
+      submits += receiver.Submits() - start;
+    }
+  }
+
+  state.SetBytesProcessed(int64_t(state.iterations()) * n);
+  state.counters["submits"] = benchmark::Counter(submits, benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(BM_IngestAsio)->Arg(166464)->Arg(665856)->Arg(1997568)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_IngestUring)->Arg(166464)->Arg(665856)->Arg(1997568)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
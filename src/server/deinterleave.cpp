@@ -0,0 +1,169 @@
+#include "deinterleave.h"
+#include "../utils/cpu_features.h"
+
+#include <immintrin.h>
+#include <algorithm>
+
+namespace deinterleave
+{
+
+// here we de-interleave the XX and YY polarization
+// src: [XX0 YY1 XX2 YY3 XX4 YY5 XX6 YY7 ...]
+// xx:  [XX0 XX2 XX4 XX6 ...]
+// yy:  [YY1 YY3 YY5 YY7 ...]
+//
+// src may alias yy, element j is always written after element 2j+1 is read
+
+void Scalar(const uint8_t *src, const std::size_t n, uint8_t *xx, uint8_t *yy)
+{
+  const uint64_t *s = reinterpret_cast<const uint64_t*>(src);
+  uint64_t *x = reinterpret_cast<uint64_t*>(xx);
+  uint64_t *y = reinterpret_cast<uint64_t*>(yy);
+
+  for (int i = 0, j = 0, m = n/8; i < m; i += 2, j++)
+  {
+    x[j] = s[i];
+    y[j] = s[i+1];
+  }
+}
+
+__attribute__((target("sse4.1")))
+void SSE4(const uint8_t *src, const std::size_t n, uint8_t *xx, uint8_t *yy)
+{
+  __m128i *s = reinterpret_cast<__m128i*>(const_cast<uint8_t*>(src));
+  __m128i *x = reinterpret_cast<__m128i*>(xx);
+  __m128i *y = reinterpret_cast<__m128i*>(yy);
+
+  __m128i a, b;
+  for (int i = 0, j = 0, m = n/16; i < m; i += 2, j++)
+  {
+    a = _mm_stream_load_si128(s + i);
+    b = _mm_stream_load_si128(s + i + 1);
+    _mm_stream_si128(x + j, _mm_unpacklo_epi64(a, b));
+    _mm_stream_si128(y + j, _mm_unpackhi_epi64(a, b));
+  }
+}
+
+__attribute__((target("avx2")))
+void AVX2(const uint8_t *src, const std::size_t n, uint8_t *xx, uint8_t *yy)
+{
+  const __m256i *s = reinterpret_cast<const __m256i*>(src);
+  __m256i *x = reinterpret_cast<__m256i*>(xx);
+  __m256i *y = reinterpret_cast<__m256i*>(yy);
+
+  __m256i a, b, c;
+  for (int i = 0, j = 0, m = n/32; i < m; i += 2, j++)
+  {
+    a = _mm256_stream_load_si256(s + i);
+    b = _mm256_stream_load_si256(s + i + 1);
+    c = _mm256_unpacklo_epi64(a, b);
+    c = _mm256_permute4x64_epi64(c, 0xd8);
+    _mm256_stream_si256(x + j, c);
+    c = _mm256_unpackhi_epi64(a, b);
+    c = _mm256_permute4x64_epi64(c, 0xd8);
+    _mm256_stream_si256(y + j, c);
+  }
+}
+
+__attribute__((target("avx512f,avx2")))
+void AVX512(const uint8_t *src, const std::size_t n, uint8_t *xx, uint8_t *yy)
+{
+  // Read chunks are only 32 byte aligned in the output (n/2 = 32 mod 64), so
+  // peel one 32 byte step until the outputs start on a 64 byte cache line.
+  // That only lines up both outputs when they share their offset in a cache
+  // line, other buffers take the narrower kernels.
+  const uintptr_t px = reinterpret_cast<uintptr_t>(xx);
+  const uintptr_t py = reinterpret_cast<uintptr_t>(yy);
+  if ((px | py) & 31)
+    return Scalar(src, n, xx, yy);
+  if ((px ^ py) & 63)
+    return AVX2(src, n, xx, yy);
+
+  std::size_t head = (px & 63) ? 64 : 0;
+  if (head > n)
+    head = 0;
+  if (head)
+    AVX2(src, head, xx, yy);
+
+  const __m512i lo = _mm512_set_epi64(14, 12, 10, 8, 6, 4, 2, 0);
+  const __m512i hi = _mm512_set_epi64(15, 13, 11, 9, 7, 5, 3, 1);
+  const uint8_t *s = src + head;
+  __m512i *x = reinterpret_cast<__m512i*>(xx + head/2);
+  __m512i *y = reinterpret_cast<__m512i*>(yy + head/2);
+
+  __m512i a, b;
+  std::size_t m = (n - head)/128;
+  for (std::size_t j = 0; j < m; j++)
+  {
+    a = _mm512_loadu_si512(s + j*128);
+    b = _mm512_loadu_si512(s + j*128 + 64);
+    _mm512_stream_si512(x + j, _mm512_permutex2var_epi64(a, lo, b));
+    _mm512_stream_si512(y + j, _mm512_permutex2var_epi64(a, hi, b));
+  }
+
+  std::size_t done = head + m*128;
+  if (done < n)
+    AVX2(src + done, n - done, xx + done/2, yy + done/2);
+}
+
+
+// Every range is de-interleaved by the scalar kernel, ranges start at any
+// channel so the outputs are only 8 byte aligned. The output never runs ahead
+// of the input, which keeps in place de-interleaving intact.
+std::size_t Selected(const uint8_t *src, const std::size_t n, const int channels, const int first, const Ranges &ranges, uint8_t *xx, uint8_t *yy)
+{
+  int pairs = n/16;
+  std::size_t out = 0;
+
+  for (int q = 0, c = first; q < pairs; q += channels - c, c = 0)
+  {
+    for (auto &r : ranges)
+    {
+      if (r.second < c)
+        continue;
+
+      int start = q + std::max(r.first, c) - c;
+      int length = std::min(q + r.second + 1 - c, pairs) - start;
+      if (length <= 0)
+        break;
+
+      Scalar(src + 16*start, 16*length, xx + 8*out, yy + 8*out);
+      out += length;
+    }
+  }
+
+  return 8*out;
+}
+
+static const std::vector<cpu::Variant<Kernel>> &Variants()
+{
+  static const std::vector<cpu::Variant<Kernel>> variants = {
+    {"scalar", 0, Scalar},
+    {"sse4", cpu::SSE41, SSE4},
+    {"avx2", cpu::AVX2, AVX2},
+    {"avx512", cpu::AVX512F | cpu::AVX2, AVX512}
+  };
+  return variants;
+}
+
+std::vector<std::string> Names()
+{
+  return cpu::Names(Variants());
+}
+
+bool Supported(const std::string &name)
+{
+  return cpu::Supported(Variants(), name);
+}
+
+std::string Resolve(const std::string &name)
+{
+  return cpu::Resolve(Variants(), name);
+}
+
+Kernel Select(const std::string &name)
+{
+  return cpu::Select(Variants(), name);
+}
+
+} // namespace deinterleave
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace deinterleave
+{
+/**
+ * @brief
+ * De-interleaves n bytes of src into xx and yy, src may alias yy as long as
+ * yy does not start beyond src.
+ */
+typedef void (*Kernel)(const uint8_t *src, const std::size_t n, uint8_t *xx, uint8_t *yy);
+
+void Scalar(const uint8_t *src, const std::size_t n, uint8_t *xx, uint8_t *yy);
+void SSE4(const uint8_t *src, const std::size_t n, uint8_t *xx, uint8_t *yy);
+void AVX2(const uint8_t *src, const std::size_t n, uint8_t *xx, uint8_t *yy);
+void AVX512(const uint8_t *src, const std::size_t n, uint8_t *xx, uint8_t *yy);
+
+/// Inclusive channel ranges, as parsed by utils::ParseChannels
+typedef std::vector<std::pair<int,int>> Ranges;
+
+/**
+ * @brief
+ * De-interleaves n bytes of src holding the visibilities of consecutive
+ * baselines of channels each, the first one at channel first, and keeps only
+ * the channels in ranges. Returns the number of bytes written to each of xx
+ * and yy, src may alias yy as with Kernel.
+ */
+std::size_t Selected(const uint8_t *src, const std::size_t n, const int channels, const int first, const Ranges &ranges, uint8_t *xx, uint8_t *yy);
+
+/// Names of all compiled kernels, fastest last
+std::vector<std::string> Names();
+
+/// True when the kernel exists and the cpu supports it, "auto" is always supported
+bool Supported(const std::string &name);
+
+/// Resolves "auto" and unsupported kernels to the fastest kernel supported by this cpu
+std::string Resolve(const std::string &name);
+
+/// Returns the kernel by name, "auto" selects the fastest supported kernel
+Kernel Select(const std::string &name);
+}
@@ -0,0 +1,75 @@
+#include "integration_queue.h"
+
+#include <utility>
+
+IntegrationQueue::IntegrationQueue(const int capacity, const std::size_t size):
+  mSlots(capacity),
+  mHead(0),
+  mTail(0),
+  mBusy(0)
+{
+  for (auto &s : mSlots)
+  {
+    s.xx.resize(size, 0);
+    s.yy.resize(size, 0);
+  }
+}
+
+Integration *IntegrationQueue::Back()
+{
+  uint64_t tail = mTail.load(std::memory_order_relaxed);
+  if (tail - mHead.load() >= mSlots.size())
+    return nullptr;
+
+  // the slot is claimed but Pop() may still be swapping it out
+  if (tail >= mSlots.size() && mBusy.load() == tail - mSlots.size() + 1)
+    return nullptr;
+
+  return &mSlots[tail % mSlots.size()];
+}
+
+void IntegrationQueue::Push()
+{
+  mTail.store(mTail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+bool IntegrationQueue::Drop()
+{
+  uint64_t head = mHead.load();
+  if (head == mTail.load(std::memory_order_relaxed))
+    return false;
+
+  // fails if the dispatcher claimed this integration first
+  return mHead.compare_exchange_strong(head, head + 1);
+}
+
+bool IntegrationQueue::Pop(Integration &integration)
+{
+  uint64_t head = mHead.load();
+  if (head == mTail.load(std::memory_order_acquire))
+    return false;
+
+  // announce the swap before claiming, see Back()
+  mBusy.store(head + 1);
+  if (!mHead.compare_exchange_strong(head, head + 1))
+  {
+    mBusy.store(0);
+    return false;
+  }
+
+  Integration &slot = mSlots[head % mSlots.size()];
+  std::swap(slot.xx, integration.xx);
+  std::swap(slot.yy, integration.yy);
+  mBusy.store(0, std::memory_order_release);
+  return true;
+}
+
+int IntegrationQueue::Size() const
+{
+  return mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire);
+}
+
+int IntegrationQueue::Capacity() const
+{
+  return mSlots.size();
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <pipeline/output_module_interface.h>
+
+/// XX and YY datums of a single correlator integration
+struct Integration
+{
+  Datum xx;
+  Datum yy;
+};
+
+/**
+ * Bounded single producer, single consumer ring of integrations. The stream
+ * fills the slot returned by Back() and publishes it with Push(), the
+ * dispatcher moves the oldest integration out with Pop(). The producer may
+ * discard the oldest integration with Drop(), both sides claim it with a CAS
+ * on the head so an integration is either dispatched or dropped, never both.
+ * No locks are taken, datums are swapped rather than copied.
+ */
+class IntegrationQueue
+{
+public:
+  IntegrationQueue(const IntegrationQueue&) = delete;
+  IntegrationQueue& operator=(const IntegrationQueue&) = delete;
+
+  IntegrationQueue(const int capacity, const std::size_t size);
+
+  Integration *Back();
+  void Push();
+  bool Drop();
+
+  bool Pop(Integration &integration);
+
+  int Size() const;
+  int Capacity() const;
+
+private:
+  std::vector<Integration> mSlots;
+  std::atomic<uint64_t> mHead; ///< next slot to dispatch or drop
+  std::atomic<uint64_t> mTail; ///< next slot to fill
+  std::atomic<uint64_t> mBusy; ///< slot index + 1 being swapped out by Pop(), 0 if none
+};
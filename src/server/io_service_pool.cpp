@@ -0,0 +1,55 @@
+#include "io_service_pool.h"
+
+#include <glog/logging.h>
+
+IoServicePool::IoServicePool(const std::vector<int> &affinity):
+  mAffinity(affinity),
+  mNext(0)
+{
+  for (auto cpu : mAffinity)
+  {
+    mServices.emplace_back(new boost::asio::io_service());
+    mWork.emplace_back(new boost::asio::io_service::work(*mServices.back()));
+
+    boost::asio::io_service &service = *mServices.back();
+    mThreads.emplace_back([&service, cpu]() {
+      cpu_set_t cpuset;
+      CPU_ZERO(&cpuset);
+      CPU_SET(cpu, &cpuset);
+      int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+      CHECK(rc == 0) << "pthread_setaffinity_np failed for cpu " << cpu;
+
+      try
+      {
+        service.run();
+      }
+      catch (std::exception& e)
+      {
+        LOG(ERROR) << e.what();
+      }
+    });
+  }
+
+  VLOG(1) << "Started " << mThreads.size() << " input thread(s)";
+}
+
+IoServicePool::~IoServicePool()
+{
+  Stop();
+}
+
+boost::asio::io_service &IoServicePool::Next(int &cpu)
+{
+  std::size_t i = mNext++ % mServices.size();
+  cpu = mAffinity[i];
+  return *mServices[i];
+}
+
+void IoServicePool::Stop()
+{
+  // let the services run out of work so pending stream shutdowns complete
+  mWork.clear();
+  for (auto &t : mThreads)
+    if (t.joinable())
+      t.join();
+}
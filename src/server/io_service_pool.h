@@ -0,0 +1,31 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/**
+ * Runs one io_service per thread, each thread pinned to its own cpu. Streams
+ * are assigned round robin so every connection gets a dedicated thread as
+ * long as there are at least as many threads as connections.
+ */
+class IoServicePool
+{
+public:
+  IoServicePool(const IoServicePool&) = delete;
+  IoServicePool& operator=(const IoServicePool&) = delete;
+
+  explicit IoServicePool(const std::vector<int> &affinity);
+  ~IoServicePool();
+
+  boost::asio::io_service &Next(int &cpu);
+  void Stop();
+
+private:
+  std::vector<std::unique_ptr<boost::asio::io_service>> mServices;
+  std::vector<std::unique_ptr<boost::asio::io_service::work>> mWork;
+  std::vector<std::thread> mThreads;
+  std::vector<int> mAffinity;
+  std::size_t mNext;
+};
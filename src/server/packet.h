@@ -4,6 +4,7 @@
 #include <bitset>
 
 #define OUTPUT_MAGIC 0x4141525446414143
+#define FORWARDED_MAGIC 0x4141525446414146 ///< OUTPUT_MAGIC of a blob handed from the channel to the calibration pipeline
 #define INPUT_MAGIC 0x3B98F002
 
 struct input_header_t
@@ -1,53 +1,96 @@
 #include "server.h"
 
 #include <glog/logging.h>
+#include "../config.h"
 
-Server::Server(boost::asio::io_service &io_service, Pipeline<DataBlob> &pipeline, uint16_t port):
-  mStreamHandler(pipeline),
-  mSignals(io_service),
+template<int NUM_ANTENNAS>
+Server<NUM_ANTENNAS>::Listener::Listener(boost::asio::io_service &io_service, const int subband, const uint16_t port, IoServicePool &pool):
+  mSubband(subband),
   mAcceptor(io_service, tcp::endpoint(tcp::v4(), port)),
-  mSocket(io_service)
+  mService(pool.Next(mCpu))
+{
+}
+
+template<int NUM_ANTENNAS>
+Server<NUM_ANTENNAS>::Server(boost::asio::io_service &io_service, IoServicePool &pool, Pipeline<DataBlob<NUM_ANTENNAS>> &pipeline, const std::vector<std::pair<int,int>> &subbands, const int cpu):
+  mPool(pool),
+  mStreamHandler(pipeline, cpu),
+  mSignals(io_service)
+{
+  mSignals.add(SIGINT);
+  mSignals.add(SIGTERM);
+  mSignals.add(SIGQUIT);
+  DoAwaitStop();
+
+  for (auto &s : subbands)
+  {
+    mListeners.emplace_back(new Listener(io_service, s.first, s.second, mPool));
+    VLOG(1) << "Listening on port " << s.second << " for subband " << s.first;
+    Listen(*mListeners.back());
+  }
+}
+
+template<int NUM_ANTENNAS>
+Server<NUM_ANTENNAS>::Server(boost::asio::io_service &io_service, IoServicePool &pool, Pipeline<DataBlob<NUM_ANTENNAS>> &pipeline, const std::vector<std::pair<int,int>> &subbands, const std::vector<std::string> &replay, const int cpu):
+  mPool(pool),
+  mStreamHandler(pipeline, cpu),
+  mSignals(io_service)
 {
   mSignals.add(SIGINT);
   mSignals.add(SIGTERM);
   mSignals.add(SIGQUIT);
   DoAwaitStop();
 
-  VLOG(1) << "Listening on port " << port;
-  Listen();
+  // without acceptors the io_service runs out of work once the signals are cancelled
+  mStreamHandler.OnIdle([this, &io_service]() {
+    io_service.post([this]() { mSignals.cancel(); });
+  });
+
+  for (std::size_t i = 0; i < replay.size(); i++)
+  {
+    int cpu;
+    boost::asio::io_service &service = mPool.Next(cpu);
+    VLOG(1) << "Replaying " << replay[i] << " as subband " << subbands[i].first;
+    mStreamHandler.Start(std::make_shared<Stream<NUM_ANTENNAS>>(replay[i], service, mStreamHandler, subbands[i].first, cpu));
+  }
 }
 
-void Server::Listen()
+template<int NUM_ANTENNAS>
+void Server<NUM_ANTENNAS>::Listen(Listener &listener)
 {
-  mAcceptor.async_accept(mSocket,
-                         [this](boost::system::error_code ec)
-                         {
-                           if (!mAcceptor.is_open())
-                             return;
-
-                           if (!ec)
-                           {
-                             mStreamHandler.Start(std::make_shared<Stream>(std::move(mSocket), mStreamHandler));
-                           }
-                           else
-                             LOG(ERROR) << ec.message();
-
-                           Listen();
-                         });
+  listener.mSocket.reset(new tcp::socket(listener.mService));
+  listener.mAcceptor.async_accept(*listener.mSocket,
+                                  [this, &listener](boost::system::error_code ec)
+                                  {
+                                    if (!listener.mAcceptor.is_open())
+                                      return;
+
+                                    if (!ec)
+                                    {
+                                      mStreamHandler.Start(std::make_shared<Stream<NUM_ANTENNAS>>(std::move(*listener.mSocket), listener.mService, mStreamHandler, listener.mSubband, listener.mCpu));
+                                    }
+                                    else
+                                      LOG(ERROR) << ec.message();
+
+                                    Listen(listener);
+                                  });
 }
 
-void Server::DoAwaitStop()
+template<int NUM_ANTENNAS>
+void Server<NUM_ANTENNAS>::DoAwaitStop()
 {
   mSignals.async_wait(
-    [this](boost::system::error_code /*ec*/, int s)
+    [this](boost::system::error_code ec, int s)
     {
+      if (ec == boost::asio::error::operation_aborted)
+        return;
+
       LOG(INFO) << "Received signal `" << strsignal(s) << "'";
-      mAcceptor.close();
+      for (auto &l : mListeners)
+        l->mAcceptor.close();
       mStreamHandler.StopAll();
     }
   );
 }
 
-
-
-
+INSTANTIATE_ANTENNAS(Server)
@@ -13,21 +13,36 @@
 #include "packet.h"
 #include "stream.h"
 #include "stream_handler.h"
+#include "io_service_pool.h"
 #include "../pipeline/datablob.h"
 
 using boost::asio::ip::tcp;
 
+template<int NUM_ANTENNAS>
 class Server
 {
 public:
-  Server(boost::asio::io_service& io_service, Pipeline<DataBlob> &pipeline, uint16_t port);
+  Server(boost::asio::io_service& io_service, IoServicePool &pool, Pipeline<DataBlob<NUM_ANTENNAS>> &pipeline, const std::vector<std::pair<int,int>> &subbands, const int cpu);
+  Server(boost::asio::io_service& io_service, IoServicePool &pool, Pipeline<DataBlob<NUM_ANTENNAS>> &pipeline, const std::vector<std::pair<int,int>> &subbands, const std::vector<std::string> &replay, const int cpu);
 
 private:
-  void Listen();
+  /// Accepts correlator streams for a single subband
+  struct Listener
+  {
+    Listener(boost::asio::io_service &io_service, const int subband, const uint16_t port, IoServicePool &pool);
+
+    int mSubband;
+    tcp::acceptor mAcceptor;
+    int mCpu;
+    boost::asio::io_service &mService;    ///< io thread of every stream of this subband, reconnects included
+    std::unique_ptr<tcp::socket> mSocket; ///< created on mService for the next stream
+  };
+
+  void Listen(Listener &listener);
   void DoAwaitStop();
 
-  StreamHandler mStreamHandler;
+  IoServicePool &mPool;
+  StreamHandler<NUM_ANTENNAS> mStreamHandler;
   boost::asio::signal_set mSignals;
-  tcp::acceptor mAcceptor;
-  tcp::socket mSocket;
+  std::vector<std::unique_ptr<Listener>> mListeners;
 };
@@ -1,30 +1,108 @@
 #include "stream.h"
 #include "stream_handler.h"
+#include "deinterleave.h"
 #include "../config.h"
 #include "../utils/utils.h"
 #include "../utils/timer.h"
+#include "../utils/placement.h"
 
 #include <glog/logging.h>
-#include <immintrin.h>
+#include <chrono>
 #include <iomanip>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-DECLARE_int32(subband);
 DECLARE_int32(antcfg);
+DECLARE_string(channels);
+DECLARE_bool(zerocopy);
+DECLARE_int32(queue_depth);
+DECLARE_string(overload);
+DECLARE_string(ingest);
+DECLARE_int32(read_size);
+DECLARE_double(replay_speed);
+DECLARE_bool(hugepages);
 
-Stream::Stream(tcp::socket socket, StreamHandler &handler):
+/// Receives per io_uring chain, two chains are kept in flight
+#define URING_BATCH 16
+
+/// Kernel used by all streams, see Stream::SelectKernel
+static deinterleave::Kernel sDeinterleave = deinterleave::Select("auto");
+
+template<int NUM_ANTENNAS>
+constexpr int Stream<NUM_ANTENNAS>::DEFAULT_READ_SIZE;
+
+template<int NUM_ANTENNAS>
+constexpr int Stream<NUM_ANTENNAS>::PAYLOAD_SIZE;
+
+template<int NUM_ANTENNAS>
+Stream<NUM_ANTENNAS>::Stream(tcp::socket socket, boost::asio::io_service &io_service, StreamHandler<NUM_ANTENNAS> &handler, const int subband, const int cpu):
   mSocket(std::move(socket)),
-  mHandler(handler)
+  mIoService(io_service),
+  mUringEvent(io_service),
+  mReplay(nullptr),
+  mReplayTimer(io_service),
+  mStopped(false),
+  mQueue(FLAGS_queue_depth, DatumSize()),
+  mDropped(0),
+  mBlockedTime(0.0),
+  mHandler(handler),
+  mCpu(cpu),
+  mNode(placement::Node(cpu)),
+  mPlace(FLAGS_hugepages),
+  mZeroCopy(FLAGS_zerocopy)
 {
   // create a buffer size b such that:
   //   n = 0 (mod b) and b = 0 (mod m), where
   //   n = 41616*63*2*8 for 288 antennas and n = 166176*63*2*8 for 576 antennas
-  //   b = 64
-  // mBuffer.resize(332352);
-  mBuffer.resize(166464);
-  mXX.resize(NUM_BASELINES*NUM_CHANNELS*sizeof(std::complex<float>) + sizeof(output_header_t), 0);
-  mYY.resize(NUM_BASELINES*NUM_CHANNELS*sizeof(std::complex<float>) + sizeof(output_header_t), 0);
+  //   m = 64
+  // which gives b = 166464 for 288 and b = 332352 for 576 antennas by
+  // default, other sizes can be given with --read_size, see ValidReadSize
+  if (FLAGS_ingest == "uring" && mSocket.is_open())
+  {
+    // chunks land in the io_uring buffers, never in the pipeline buffers
+    LOG_IF(WARNING, mZeroCopy) << "--zerocopy is ignored with --ingest=uring";
+    mZeroCopy = false;
+    mUring.reset(new UringReceiver(mSocket.native_handle(), ReadSize(), URING_BATCH));
+  }
+  else if (!mZeroCopy)
+    mBuffer.resize(ReadSize());
+  mSlot = mQueue.Back();
+
+  if (FLAGS_overload == "drop-oldest")
+    mOverload = Overload::DROP_OLDEST;
+  else if (FLAGS_overload == "drop-newest")
+    mOverload = Overload::DROP_NEWEST;
+  else
+    mOverload = Overload::BLOCK;
+
+  // the dropping policies keep receiving into a spare while the queue is full
+  if (mOverload != Overload::BLOCK)
+  {
+    mSpare.xx.resize(DatumSize(), 0);
+    mSpare.yy.resize(DatumSize(), 0);
+  }
+  mInFlight.xx.resize(DatumSize(), 0);
+  mInFlight.yy.resize(DatumSize(), 0);
+  Place(mSpare);
+  Place(mInFlight);
 
-  mOutputHdr.subband = FLAGS_subband;
+  // channels outside --channels are dropped while de-interleaving, the
+  // datum holds NumSelected() channels per baseline
+  mExcluded.set();
+  for (auto &r : Channels())
+    for (int c = r.first; c <= r.second; c++)
+      mExcluded[c+1] = false;
+  for (int c = 0, n = 0; c < NUM_CHANNELS; c++)
+  {
+    mSelectedBefore[c] = n;
+    n += !mExcluded[c+1];
+  }
+
+  mOutputHdr.subband = subband;
   mOutputHdr.antenna_config = FLAGS_antcfg;
   mOutputHdr.num_channels = NUM_CHANNELS + 1;
   mOutputHdr.num_antennas = NUM_ANTENNAS;
@@ -32,112 +110,507 @@ Stream::Stream(tcp::socket socket, StreamHandler &handler):
 }
 
 
-void Stream::Start()
+template<int NUM_ANTENNAS>
+Stream<NUM_ANTENNAS>::Stream(const std::string &path, boost::asio::io_service &io_service, StreamHandler<NUM_ANTENNAS> &handler, const int subband, const int cpu):
+  Stream(tcp::socket(io_service), io_service, handler, subband, cpu)
 {
-  mBytesRead = mTotalBytesRead = 0;
-  VLOG(1) << mSocket.remote_endpoint().address() << ":" << mSocket.remote_endpoint().port() << " connected";
+  // integrations are de-interleaved straight from the mapping
+  mZeroCopy = false;
+  Datum().swap(mBuffer);
+  mEndpoint = path;
+
+  int fd = open(path.c_str(), O_RDONLY);
+  CHECK(fd >= 0) << "Failed to open " << path;
+  struct stat st;
+  CHECK(fstat(fd, &st) == 0) << "Failed to stat " << path;
+  mReplaySize = st.st_size;
+  void *data = mmap(0, mReplaySize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  CHECK(data != MAP_FAILED) << "Failed to map " << path;
+  madvise(data, mReplaySize, MADV_SEQUENTIAL);
+  mReplay = static_cast<const uint8_t*>(data);
+  mReplayOffset = 0;
+
+  LOG_IF(WARNING, mReplaySize % (sizeof(input_header_t) + PAYLOAD_SIZE) != 0)
+    << path << " ends with a partial integration";
+}
+
+
+template<int NUM_ANTENNAS>
+Stream<NUM_ANTENNAS>::~Stream()
+{
+  if (mReplay)
+    munmap(const_cast<uint8_t*>(mReplay), mReplaySize);
+}
+
+
+template<int NUM_ANTENNAS>
+std::size_t Stream<NUM_ANTENNAS>::DatumSize()
+{
+  // In zero-copy mode a chunk is received at the YY payload offset it
+  // de-interleaves to, i*b/2 for chunk i, so the last chunk extends b/2 bytes
+  // beyond the visibilities. Dropping channels makes the offset smaller than
+  // i*b/2 and a chunk can extend up to b bytes beyond.
+  int extra = NumSelected() == NUM_CHANNELS ? ReadSize()/2 : ReadSize();
+  return sizeof(output_header_t) + Config<NUM_ANTENNAS>::NUM_BASELINES*NumSelected()*sizeof(std::complex<float>) + extra;
+}
+
+
+template<int NUM_ANTENNAS>
+const deinterleave::Ranges &Stream<NUM_ANTENNAS>::Channels()
+{
+  static const deinterleave::Ranges channels = utils::ParseChannels(FLAGS_channels);
+  return channels;
+}
+
+
+template<int NUM_ANTENNAS>
+int Stream<NUM_ANTENNAS>::NumSelected()
+{
+  int n = 0;
+  for (auto &r : Channels())
+    n += r.second - r.first + 1;
+  return n;
+}
+
+
+template<int NUM_ANTENNAS>
+std::size_t Stream<NUM_ANTENNAS>::Offset(const std::size_t bytes) const
+{
+  // bytes of one polarization the first bytes of the payload de-interleave to
+  std::size_t q = bytes/16;
+  return 8*((q/NUM_CHANNELS)*NumSelected() + mSelectedBefore[q%NUM_CHANNELS]);
+}
+
+
+template<int NUM_ANTENNAS>
+int Stream<NUM_ANTENNAS>::ReadSize()
+{
+  return FLAGS_read_size > 0 ? FLAGS_read_size : DEFAULT_READ_SIZE;
+}
+
+
+template<int NUM_ANTENNAS>
+bool Stream<NUM_ANTENNAS>::ValidReadSize(const int size)
+{
+  // A chunk is split in two 32 byte aligned halves and must not be mistaken
+  // for a header, chunks never straddle two integrations.
+  return size > int(sizeof(input_header_t)) && size % 64 == 0 && PAYLOAD_SIZE % size == 0;
+}
+
+
+template<int NUM_ANTENNAS>
+void Stream<NUM_ANTENNAS>::Start()
+{
+  mBytesRead = mTotalBytesRead = mStagedBytes = mDirectBytes = 0;
+  mStagedTime = mDirectTime = 0.0;
+  if (!mReplay)
+  {
+    std::stringstream ss;
+    ss << mSocket.remote_endpoint().address() << ":" << mSocket.remote_endpoint().port();
+    mEndpoint = ss.str();
+  }
+  VLOG(1) << mEndpoint << " connected (subband " << mOutputHdr.subband << ", cpu " << mCpu << ")";
+  VLOG_IF(1, mPlace) << mEndpoint << " buffers on node " << mNode << ": " << placement::Report();
   mTime = timer::GetRealTime();
-  Read(sizeof(input_header_t));
+
+  if (mReplay)
+  {
+    auto self(this->shared_from_this());
+    mIoService.post([this, self]() { Replay(); });
+  }
+  else if (mUring)
+  {
+    mScheduled = 0;
+    mUringEvent.assign(dup(mUring->EventFd()));
+    mUring->Start([this]() { return NextReceive(); });
+    WaitUring();
+  }
+  else
+    Read(reinterpret_cast<uint8_t*>(&mInputHdr), sizeof(input_header_t));
 }
 
-void Stream::Read(int n)
+template<int NUM_ANTENNAS>
+void Stream<NUM_ANTENNAS>::Read(uint8_t *dst, int n)
 {
-  auto self(shared_from_this());
-  boost::asio::async_read(mSocket, boost::asio::buffer(mBuffer.data(), n),
+  auto self(this->shared_from_this());
+  boost::asio::async_read(mSocket, boost::asio::buffer(dst, n),
                           [this, self](boost::system::error_code ec, std::size_t length)
                           {
+                            // a read that completed before Stop() closed the socket
+                            if (mStopped)
+                              return;
+
                             if (!ec)
                             {
                               Parse(length);
                             }
                             else if (ec != boost::asio::error::operation_aborted)
                             {
-                              mHandler.Stop(shared_from_this());
+                              mHandler.Stop(self);
                             }
                           });
 }
 
 
-void Stream::Parse(std::size_t length)
+template<int NUM_ANTENNAS>
+void Stream<NUM_ANTENNAS>::ReadChunk()
+{
+  // The YY payload beyond mBytesRead/2 has not been written yet, so in
+  // zero-copy mode it doubles as the receive buffer for the next chunk.
+  if (mZeroCopy)
+    Read(mSlot->yy.data() + sizeof(output_header_t) + Offset(mBytesRead), ReadSize());
+  else
+    Read(mBuffer.data(), mBuffer.size());
+}
+
+
+template<int NUM_ANTENNAS>
+void Stream<NUM_ANTENNAS>::WaitUring()
+{
+  auto self(this->shared_from_this());
+  mUringEvent.async_read_some(boost::asio::buffer(&mUringEvents, sizeof(mUringEvents)),
+                              [this, self](boost::system::error_code ec, std::size_t)
+                              {
+                                if (mStopped)
+                                  return;
+
+                                if (ec)
+                                {
+                                  if (ec != boost::asio::error::operation_aborted)
+                                    mHandler.Stop(self);
+                                  return;
+                                }
+
+                                if (mUring->Reap([this](const uint8_t *data, std::size_t length) { Receive(data, length); }))
+                                  WaitUring();
+                                else
+                                  mHandler.Stop(self);
+                              });
+}
+
+
+template<int NUM_ANTENNAS>
+std::size_t Stream<NUM_ANTENNAS>::NextReceive()
+{
+  // every integration is a header followed by n/b chunks
+  if (mScheduled == 0)
+  {
+    mScheduled = PAYLOAD_SIZE;
+    return sizeof(input_header_t);
+  }
+
+  mScheduled -= ReadSize();
+  return ReadSize();
+}
+
+
+template<int NUM_ANTENNAS>
+void Stream<NUM_ANTENNAS>::Receive(const uint8_t *data, std::size_t length)
 {
+  if (length == sizeof(input_header_t))
+    memcpy(&mInputHdr, data, length);
+
+  Consume(data, length);
+}
+
+
+template<int NUM_ANTENNAS>
+void Stream<NUM_ANTENNAS>::Replay()
+{
+  // one integration per handler so Stop() can interleave
+  if (mStopped)
+    return;
+
+  auto self(this->shared_from_this());
+  if (mReplayOffset + sizeof(input_header_t) + PAYLOAD_SIZE > mReplaySize)
+  {
+    mHandler.Stop(self);
+    return;
+  }
+
+  const uint8_t *data = mReplay + mReplayOffset;
+  memcpy(&mInputHdr, data, sizeof(input_header_t));
+  CHECK(mInputHdr.magic == INPUT_MAGIC) << mEndpoint << ": invalid magic at offset " << mReplayOffset;
+
+  // in paced mode an integration is released once its recorded start time,
+  // scaled by --replay_speed, has passed since the first one
+  if (FLAGS_replay_speed > 0.0)
+  {
+    double now = timer::GetRealTime();
+    if (mReplayOffset == 0)
+    {
+      mReplayStart = now;
+      mReplayEpoch = mInputHdr.startTime;
+    }
+
+    double wait = mReplayStart + (mInputHdr.startTime - mReplayEpoch)/FLAGS_replay_speed - now;
+    if (wait > 1e-3)
+    {
+      mReplayTimer.expires_from_now(std::chrono::microseconds(int64_t(wait*1e6)));
+      mReplayTimer.async_wait([this, self](boost::system::error_code ec)
+      {
+        if (!ec)
+          Replay();
+      });
+      return;
+    }
+  }
+
+  Consume(data, sizeof(input_header_t));
+  data += sizeof(input_header_t);
+  for (int i = 0; i < PAYLOAD_SIZE; i += ReadSize())
+    Consume(data + i, ReadSize());
+  mReplayOffset += sizeof(input_header_t) + PAYLOAD_SIZE;
+
+  mIoService.post([this, self]() { Replay(); });
+}
+
+
+template<int NUM_ANTENNAS>
+void Stream<NUM_ANTENNAS>::Parse(std::size_t length)
+{
+  if (Consume(mZeroCopy ? nullptr : mBuffer.data(), length))
+    Read(reinterpret_cast<uint8_t*>(&mInputHdr), sizeof(input_header_t));
+  else
+    ReadChunk();
+}
+
+
+template<int NUM_ANTENNAS>
+bool Stream<NUM_ANTENNAS>::Consume(const uint8_t *src, std::size_t length)
+{
+  // src is null when the chunk was received in place, returns true when the
+  // integration is complete and a header is expected next
   mTotalBytesRead += length;
 
   if (length == sizeof(input_header_t))
   {
-    memcpy(&mInputHdr, mBuffer.data(), sizeof(input_header_t));
     mBytesRead = 0;
-    Read(mBuffer.size());
-    return;
+    return false;
   }
 
-  Stream::Deinterleave(mBuffer, mXX, mYY, mBytesRead/16);
+  std::size_t offset = Offset(mBytesRead);
+  uint8_t *xx = mSlot->xx.data() + sizeof(output_header_t) + offset;
+  uint8_t *yy = mSlot->yy.data() + sizeof(output_header_t) + offset;
+  const bool direct = src == nullptr;
+  if (direct)
+    src = yy;
+
+  double start = timer::GetRealTime();
+  if (mExcluded.count() == 1)
+    Deinterleave(src, length, xx, yy);
+  else
+    deinterleave::Selected(src, length, NUM_CHANNELS, (mBytesRead/16) % NUM_CHANNELS, Channels(), xx, yy);
+  double elapsed = timer::GetRealTime() - start;
   mBytesRead += length;
 
-  if (mBytesRead >= NUM_BASELINES*NUM_POLARIZATIONS*NUM_CHANNELS*8)
+  if (direct)
+  {
+    mDirectBytes += length;
+    mDirectTime += elapsed;
+  }
+  else
+  {
+    mStagedBytes += length;
+    mStagedTime += elapsed;
+  }
+
+  if (mBytesRead >= PAYLOAD_SIZE)
   {
     CHECK(mInputHdr.magic == INPUT_MAGIC) << "Invalid magic!";
     mOutputHdr.start_time = mInputHdr.startTime;
     mOutputHdr.end_time = mInputHdr.endTime;
     mOutputHdr.flagged_dipoles.reset();
-    mOutputHdr.flagged_channels.reset();
-    mOutputHdr.flagged_channels[0] = true;
+    mOutputHdr.flagged_channels = mExcluded;
     memcpy(mOutputHdr.weights, mInputHdr.weights, 78*sizeof(uint32_t));
     mOutputHdr.polarization = 0;
-    memcpy(mXX.data(), &mOutputHdr, sizeof(mOutputHdr));
-    mHandler.mPipeline.SwapAndProcess(mXX);
+    memcpy(mSlot->xx.data(), &mOutputHdr, sizeof(mOutputHdr));
     mOutputHdr.polarization = 1;
-    memcpy(mYY.data(), &mOutputHdr, sizeof(mOutputHdr));
-    mHandler.mPipeline.SwapAndProcess(mYY);
-
-    Read(sizeof(input_header_t));
+    memcpy(mSlot->yy.data(), &mOutputHdr, sizeof(mOutputHdr));
+    Publish();
+    NextSlot();
+    return true;
   }
-  else
-    Read(mBuffer.size());
+
+  return false;
 }
 
 
-void Stream::Deinterleave(const Datum &src, Datum &xx, Datum &yy, const int start)
+template<int NUM_ANTENNAS>
+void Stream<NUM_ANTENNAS>::Publish()
 {
-  // here we de-interleave the XX and YY polarization
-  // src: [XX0 YY1 XX2 YY3 XX4 YY5 XX6 YY7 ...]
-  // xx:  [XX0 XX2 XX4 XX6 ...]
-  // yy:  [YY1 YY3 YY5 YY7 ...]
+  if (mSlot != &mSpare)
+  {
+    mQueue.Push();
+    mHandler.Notify();
+    return;
+  }
+
+  // The queue was full when this integration started, take a slot if one
+  // was freed in the meantime. Both polarizations are dropped together.
+  Integration *slot = mQueue.Back();
+  if (slot == nullptr && mOverload == Overload::DROP_OLDEST)
+  {
+    while ((slot = mQueue.Back()) == nullptr)
+    {
+      // Back() is also empty handed while the dispatcher swaps out a slot
+      if (mQueue.Size() >= mQueue.Capacity() && mQueue.Drop())
+      {
+        mDropped++;
+        LOG(WARNING) << mEndpoint << " dropped oldest queued integration, " << mDropped << " dropped so far";
+      }
+      else
+        std::this_thread::yield();
+    }
+  }
+
+  if (slot == nullptr)
+  {
+    mDropped++;
+    LOG(WARNING) << mEndpoint << " dropped integration " << mInputHdr.startTime << ", " << mDropped << " dropped so far";
+    return;
+  }
+
+  std::swap(slot->xx, mSpare.xx);
+  std::swap(slot->yy, mSpare.yy);
+  mQueue.Push();
+  mHandler.Notify();
+}
+
 
-#ifdef __AVX2__
-  const __m256i *s = reinterpret_cast<const __m256i*>(src.data());
-  __m256i *x = reinterpret_cast<__m256i*>(xx.data() + sizeof(output_header_t) + start * 8);
-  __m256i *y = reinterpret_cast<__m256i*>(yy.data() + sizeof(output_header_t) + start * 8);
+template<int NUM_ANTENNAS>
+void Stream<NUM_ANTENNAS>::NextSlot()
+{
+  if ((mSlot = mQueue.Back()) != nullptr)
+    return;
 
-  __m256i a, b, c;
-  for (int i = 0, j = 0, n = src.size()/32; i < n; i += 2, j++)
+  if (mOverload != Overload::BLOCK)
   {
-    a = _mm256_stream_load_si256(s + i);
-    b = _mm256_stream_load_si256(s + i + 1);
-    c = _mm256_unpacklo_epi64(a, b);
-    c = _mm256_permute4x64_epi64(c, 0xd8);
-    _mm256_stream_si256(x + j, c);
-    c = _mm256_unpackhi_epi64(a, b);
-    c = _mm256_permute4x64_epi64(c, 0xd8);
-    _mm256_stream_si256(y + j, c);
+    mSlot = &mSpare;
+    return;
   }
-#else
-  const uint64_t *s = reinterpret_cast<const uint64_t*>(src.data());
-  uint64_t *x = reinterpret_cast<uint64_t*>(xx.data() + sizeof(output_header_t));
-  uint64_t *y = reinterpret_cast<uint64_t*>(yy.data() + sizeof(output_header_t));
 
-  for (int i = 0, j = start, n = src.size()/8; i < n; i += 2, j++)
+  // wait for the dispatcher when the pipeline falls behind, it signals every
+  // integration it takes from the queue
+  double start = timer::GetRealTime();
+  std::unique_lock<std::mutex> lock(mSlotMutex);
+  mSlotFreed.wait(lock, [this]{ return (mSlot = mQueue.Back()) != nullptr; });
+  mBlockedTime = mBlockedTime + (timer::GetRealTime() - start);
+}
+
+
+template<int NUM_ANTENNAS>
+bool Stream<NUM_ANTENNAS>::Dispatch()
+{
+  // runs on the dispatcher thread, the only consumer of mQueue
+  if (!mQueue.Pop(mInFlight))
+    return false;
+
+  // datums circulate between the queues and the pipeline pool, each is
+  // placed the first time it passes by
   {
-    x[j] = s[i];
-    y[j] = s[i+1];
+    std::lock_guard<std::mutex> lock(mSlotMutex);
   }
-#endif
+  mSlotFreed.notify_one();
+
+  Place(mInFlight);
+  mHandler.mPipeline.SwapAndProcess(mInFlight.xx);
+  mHandler.mPipeline.SwapAndProcess(mInFlight.yy);
+  Place(mInFlight);
+  return true;
+}
+
+
+template<int NUM_ANTENNAS>
+void Stream<NUM_ANTENNAS>::Place(Integration &integration)
+{
+  if (!mPlace)
+    return;
+
+  if (!integration.xx.empty())
+    placement::Place(integration.xx.data(), integration.xx.size(), mNode);
+  if (!integration.yy.empty())
+    placement::Place(integration.yy.data(), integration.yy.size(), mNode);
+}
+
+
+template<int NUM_ANTENNAS>
+bool Stream<NUM_ANTENNAS>::Stopped() const
+{
+  return mStopped;
+}
+
+
+template<int NUM_ANTENNAS>
+uint64_t Stream<NUM_ANTENNAS>::Dropped() const
+{
+  return mDropped;
+}
+
+
+template<int NUM_ANTENNAS>
+double Stream<NUM_ANTENNAS>::BlockedTime() const
+{
+  return mBlockedTime;
 }
 
 
-void Stream::Stop()
+template<int NUM_ANTENNAS>
+void Stream<NUM_ANTENNAS>::Deinterleave(const Datum &src, Datum &xx, Datum &yy, const int start)
 {
-  mTime = timer::GetRealTime() - mTime;
-  VLOG(1) << "Throughput " << (mTotalBytesRead*8/(mTime*1e9)) << " Gb/s";
-  VLOG(1) << mSocket.remote_endpoint().address() << ":" << mSocket.remote_endpoint().port() << " disconnected";
-  mSocket.close();
+  Deinterleave(src.data(),
+               src.size(),
+               xx.data() + sizeof(output_header_t) + start * 8,
+               yy.data() + sizeof(output_header_t) + start * 8);
 }
+
+
+template<int NUM_ANTENNAS>
+void Stream<NUM_ANTENNAS>::Deinterleave(const uint8_t *src, const std::size_t n, uint8_t *xx, uint8_t *yy)
+{
+  sDeinterleave(src, n, xx, yy);
+}
+
+
+template<int NUM_ANTENNAS>
+std::string Stream<NUM_ANTENNAS>::SelectKernel(const std::string &name)
+{
+  sDeinterleave = deinterleave::Select(name);
+  return deinterleave::Resolve(name);
+}
+
+
+template<int NUM_ANTENNAS>
+void Stream<NUM_ANTENNAS>::Stop()
+{
+  // the socket belongs to the io thread of this stream
+  auto self(this->shared_from_this());
+  mIoService.post([this, self]()
+  {
+    if (mStopped)
+      return;
+    mStopped = true;
+
+    mTime = timer::GetRealTime() - mTime;
+    VLOG(1) << mEndpoint << " throughput " << (mTotalBytesRead*8/(mTime*1e9)) << " Gb/s on cpu " << mCpu;
+    VLOG(1) << "Ingest " << (mStagedBytes*1e-9/mTime) << " GB/s staged at "
+            << (mStagedBytes ? mStagedTime*1e9/mStagedBytes : 0.0) << " ns/byte de-interleaving, "
+            << (mDirectBytes*1e-9/mTime) << " GB/s zero-copy at "
+            << (mDirectBytes ? mDirectTime*1e9/mDirectBytes : 0.0) << " ns/byte";
+    VLOG(1) << mEndpoint << " dropped " << mDropped << " integrations, blocked for " << mBlockedTime << " s";
+    mHandler.Account(mDropped, mBlockedTime);
+    if (mUring)
+    {
+      VLOG_IF(1, mTotalBytesRead > 0) << mEndpoint << " " << (mUring->Submits()*double(PAYLOAD_SIZE)/mTotalBytesRead) << " io_uring submits per integration";
+      mUringEvent.close();
+      mUring.reset();
+    }
+    VLOG(1) << mEndpoint << " disconnected";
+    mReplayTimer.cancel();
+    mSocket.close();
+    mHandler.Notify();
+  });
+}
+
+INSTANTIATE_ANTENNAS(Stream)
@@ -1,42 +1,114 @@
 #pragma once
 
 #include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <vector>
 #include <complex>
+#include <memory>
 #include "packet.h"
+#include "deinterleave.h"
+#include "integration_queue.h"
+#include "uring_receiver.h"
+#include "../config.h"
 #include <pipeline/output_module_interface.h>
 
 using boost::asio::ip::tcp;
 
+template<int NUM_ANTENNAS>
 class StreamHandler;
 
-class Stream: public std::enable_shared_from_this<Stream>
+template<int NUM_ANTENNAS>
+class Stream: public std::enable_shared_from_this<Stream<NUM_ANTENNAS>>
 {
 public:
   Stream(const Stream&) = delete;
   Stream& operator=(const Stream&) = delete;
-  explicit Stream(tcp::socket socket, StreamHandler &handler);
+  Stream(tcp::socket socket, boost::asio::io_service &io_service, StreamHandler<NUM_ANTENNAS> &handler, const int subband, const int cpu);
+  Stream(const std::string &path, boost::asio::io_service &io_service, StreamHandler<NUM_ANTENNAS> &handler, const int subband, const int cpu);
+  ~Stream();
 
   void Start();
   void Stop();
+  bool Dispatch();
+  bool Stopped() const;
+  uint64_t Dropped() const;
+  double BlockedTime() const;
   static void Deinterleave(const Datum &src, Datum &xx, Datum &yy, const int start);
+  static void Deinterleave(const uint8_t *src, const std::size_t n, uint8_t *xx, uint8_t *yy);
+  static std::size_t DatumSize();
+  static const deinterleave::Ranges &Channels();
+  static int NumSelected();
+  static int ReadSize();
+  static bool ValidReadSize(const int size);
+  static std::string SelectKernel(const std::string &name);
 
 private:
-  void Read(int n);
+  /// Number of bytes requested per read unless --read_size is given, see Stream::Stream
+  static constexpr int DEFAULT_READ_SIZE = NUM_ANTENNAS == 288 ? 166464 : 332352;
+  /// Payload bytes of one integration, both polarizations
+  static constexpr int PAYLOAD_SIZE = Config<NUM_ANTENNAS>::NUM_BASELINES*NUM_POLARIZATIONS*NUM_CHANNELS*8;
+
+  /// What to do with a completed integration when the queue is full
+  enum class Overload { BLOCK, DROP_OLDEST, DROP_NEWEST };
+
+  std::size_t Offset(const std::size_t bytes) const;
+  void Read(uint8_t *dst, int n);
+  void ReadChunk();
   void Parse(std::size_t length);
+  bool Consume(const uint8_t *src, std::size_t length);
+  void Receive(const uint8_t *data, std::size_t length);
+  std::size_t NextReceive();
+  void WaitUring();
+  void Replay();
+  void Publish();
+  void NextSlot();
+  void Place(Integration &integration);
 
   tcp::socket mSocket;
+  boost::asio::io_service &mIoService;
+  std::string mEndpoint;
   input_header_t mInputHdr;
   output_header_t mOutputHdr;
 
   Datum mBuffer;
-  Datum mXX;
-  Datum mYY;
-  StreamHandler &mHandler;
+  std::bitset<64> mExcluded;        ///< flagged_channels of the channels not in --channels
+  int mSelectedBefore[NUM_CHANNELS]; ///< selected channels below each channel
+  std::unique_ptr<UringReceiver> mUring;
+  boost::asio::posix::stream_descriptor mUringEvent;
+  uint64_t mUringEvents;
+  int mScheduled;         ///< payload bytes of the current integration not yet scheduled on mUring
+  const uint8_t *mReplay; ///< memory mapped recording, null for network streams
+  std::size_t mReplaySize;
+  std::size_t mReplayOffset;
+  double mReplayStart;    ///< wall clock and recorded start time of the first replayed integration
+  double mReplayEpoch;
+  boost::asio::steady_timer mReplayTimer;
+  std::atomic<bool> mStopped; ///< set on the io thread once Stop() ran, nothing is published after
+  IntegrationQueue mQueue;
+  Integration *mSlot;     ///< integration being received, owned by this stream
+  Integration mSpare;     ///< receives an integration while the queue is full
+  Integration mInFlight;  ///< integration being dispatched, owned by the dispatcher
+  std::mutex mSlotMutex;
+  std::condition_variable mSlotFreed; ///< signalled by Dispatch() when a queue slot is freed
+  Overload mOverload;
+  std::atomic<uint64_t> mDropped;
+  std::atomic<double> mBlockedTime;
+  StreamHandler<NUM_ANTENNAS> &mHandler;
+  int mCpu;
+  int mNode;              ///< NUMA node of mCpu, -1 if unknown
+  bool mPlace;            ///< place buffers on huge pages and mNode, see --hugepages
   uint32_t mBytesRead;
   uint64_t mTotalBytesRead;
+  uint64_t mStagedBytes;  ///< payload bytes copied through mBuffer
+  uint64_t mDirectBytes;  ///< payload bytes received straight into pipeline buffers
+  double mStagedTime;     ///< seconds spent de-interleaving mStagedBytes
+  double mDirectTime;     ///< seconds spent de-interleaving mDirectBytes in place
+  bool mZeroCopy;
   double mTime;
-
 };
 
-typedef std::shared_ptr<Stream> StreamPtr;
+template<int NUM_ANTENNAS>
+using StreamPtr = std::shared_ptr<Stream<NUM_ANTENNAS>>;
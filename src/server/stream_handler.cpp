@@ -1,26 +1,166 @@
 #include "stream_handler.h"
+#include "../config.h"
 
-void StreamHandler::Start(StreamPtr stream)
+#include <glog/logging.h>
+
+template<int NUM_ANTENNAS>
+void StreamHandler<NUM_ANTENNAS>::Start(StreamPtr<NUM_ANTENNAS> stream)
 {
-  mStreams.insert(stream);
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStreams.insert(stream);
+  }
   stream->Start();
 }
 
-void StreamHandler::Stop(StreamPtr stream)
+template<int NUM_ANTENNAS>
+void StreamHandler<NUM_ANTENNAS>::Stop(StreamPtr<NUM_ANTENNAS> stream)
 {
-  mStreams.erase(stream);
+  bool idle;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStreams.erase(stream);
+    mDraining.insert(stream);
+    mPending = true;
+    idle = mStreams.empty();
+  }
+  mWake.notify_one();
   stream->Stop();
+
+  if (idle && mOnIdle)
+    mOnIdle();
+}
+
+template<int NUM_ANTENNAS>
+void StreamHandler<NUM_ANTENNAS>::OnIdle(std::function<void()> callback)
+{
+  mOnIdle = callback;
+}
+
+template<int NUM_ANTENNAS>
+void StreamHandler<NUM_ANTENNAS>::Notify()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPending = true;
+  }
+  mWake.notify_one();
+}
+
+template<int NUM_ANTENNAS>
+void StreamHandler<NUM_ANTENNAS>::StopAll()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto s: mStreams)
+    {
+      s->Stop();
+      mDraining.insert(s);
+    }
+    mStreams.clear();
+    mPending = true;
+  }
+  mWake.notify_one();
+}
+
+template<int NUM_ANTENNAS>
+void StreamHandler<NUM_ANTENNAS>::Account(const uint64_t dropped, const double blocked)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mDropped += dropped;
+  mBlockedTime = mBlockedTime + blocked;
+}
+
+template<int NUM_ANTENNAS>
+uint64_t StreamHandler<NUM_ANTENNAS>::Dropped() const
+{
+  uint64_t dropped = mDropped;
+  std::lock_guard<std::mutex> lock(mMutex);
+  for (auto &s : mStreams)
+    dropped += s->Dropped();
+  return dropped;
 }
 
-void StreamHandler::StopAll()
+template<int NUM_ANTENNAS>
+double StreamHandler<NUM_ANTENNAS>::BlockedTime() const
 {
-  for (auto s: mStreams)
-    s->Stop();
-  mStreams.clear();
+  double blocked = mBlockedTime;
+  std::lock_guard<std::mutex> lock(mMutex);
+  for (auto &s : mStreams)
+    blocked += s->BlockedTime();
+  return blocked;
 }
 
-StreamHandler::StreamHandler(Pipeline<DataBlob> &pipeline):
-  mPipeline(pipeline)
+template<int NUM_ANTENNAS>
+void StreamHandler<NUM_ANTENNAS>::Dispatch(const int cpu)
 {
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  CPU_SET(cpu, &cpuset);
+  int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+  CHECK(rc == 0) << "pthread_setaffinity_np failed for cpu " << cpu;
+
+  // Streams publish completed integrations through their lock free queue
+  // and wake the dispatcher with Notify(), the lock below guards the
+  // (rarely changing) stream set and the wake up. A pass that dispatched
+  // something is followed by another one without sleeping.
+  bool idle = false;
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mWake.wait(lock, [this, idle]{ return !idle || mPending || !mRunning; });
+      if (!mRunning)
+        break;
+      mPending = false;
+      mDispatching.assign(mStreams.begin(), mStreams.end());
+      mDispatching.insert(mDispatching.end(), mDraining.begin(), mDraining.end());
+    }
+
+    // a stopped stream is drained once its queue is empty after its Stop()
+    // ran on the io thread, it publishes nothing after that
+    idle = true;
+    for (auto &s : mDispatching)
+    {
+      bool stopped = s->Stopped();
+      if (s->Dispatch())
+        idle = false;
+      else if (stopped)
+      {
+        {
+          std::lock_guard<std::mutex> lock(mMutex);
+          mDraining.erase(s);
+        }
+        mDrained.notify_all();
+      }
+    }
+    mDispatching.clear();
+  }
+}
+
+template<int NUM_ANTENNAS>
+StreamHandler<NUM_ANTENNAS>::StreamHandler(Pipeline<DataBlob<NUM_ANTENNAS>> &pipeline, const int cpu):
+  mPipeline(pipeline),
+  mPending(false),
+  mRunning(true),
+  mDropped(0),
+  mBlockedTime(0.0)
+{
+  mDispatcher = std::thread(&StreamHandler<NUM_ANTENNAS>::Dispatch, this, cpu);
+}
+
+template<int NUM_ANTENNAS>
+StreamHandler<NUM_ANTENNAS>::~StreamHandler()
+{
+  // hand integrations still queued by stopped streams to the pipeline
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDrained.wait(lock, [this]{ return mDraining.empty(); });
+    mRunning = false;
+  }
+  mWake.notify_one();
+  mDispatcher.join();
+  VLOG(1) << "Dropped " << Dropped() << " integrations, streams blocked for " << BlockedTime() << " s";
+}
 
-}
\ No newline at end of file
+INSTANTIATE_ANTENNAS(StreamHandler)
@@ -1,24 +1,50 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
 #include <set>
+#include <thread>
+#include <vector>
 #include <pipeline/pipeline.h>
 #include "stream.h"
 #include "../pipeline/datablob.h"
 
+template<int NUM_ANTENNAS>
 class StreamHandler
 {
 public:
   StreamHandler(const StreamHandler&) = delete;
   StreamHandler& operator=(const StreamHandler&) = delete;
 
-  StreamHandler(Pipeline<DataBlob> &pipeline);
+  StreamHandler(Pipeline<DataBlob<NUM_ANTENNAS>> &pipeline, const int cpu);
+  ~StreamHandler();
 
-  void Start(StreamPtr stream);
-  void Stop(StreamPtr stream);
+  void Start(StreamPtr<NUM_ANTENNAS> stream);
+  void Stop(StreamPtr<NUM_ANTENNAS> stream);
   void StopAll();
+  void OnIdle(std::function<void()> callback);
+  void Notify();
+  void Account(const uint64_t dropped, const double blocked);
+  uint64_t Dropped() const;
+  double BlockedTime() const;
 
-  Pipeline<DataBlob> &mPipeline;
+  Pipeline<DataBlob<NUM_ANTENNAS>> &mPipeline;
 
 private:
-  std::set<StreamPtr> mStreams;
+  void Dispatch(const int cpu);
+
+  mutable std::mutex mMutex;
+  std::set<StreamPtr<NUM_ANTENNAS>> mStreams;
+  std::set<StreamPtr<NUM_ANTENNAS>> mDraining; ///< stopped streams with queued integrations
+  std::vector<StreamPtr<NUM_ANTENNAS>> mDispatching;
+  std::function<void()> mOnIdle; ///< called when the last stream stopped
+  std::condition_variable mWake;    ///< signalled by Notify(), the dispatcher sleeps on it when idle
+  std::condition_variable mDrained; ///< signalled when a stream left mDraining
+  bool mPending;                    ///< a stream published or stopped since the last pass
+  std::atomic<bool> mRunning;
+  std::atomic<uint64_t> mDropped;   ///< integrations dropped by stopped streams
+  std::atomic<double> mBlockedTime; ///< seconds stopped streams waited for the pipeline
+  std::thread mDispatcher;
 };
@@ -5,27 +5,45 @@
 using namespace ::testing;
 using boost::asio::ip::tcp;
 
-DEFINE_int32(subband, 300, "Lofar subband that defines the frequency of incoming data");
+DEFINE_string(channels, "0-62", "List of channel ranges to use e.g. '0-10,12-30,31-31' (inclusive)");
 DEFINE_int32(antcfg, 0, "0=LBA_OUTER, 1=LBA_INNER, 2=LBA_SPARSE_EVEN, 3=LBA_SPARSE_ODD");
+DEFINE_bool(zerocopy, false, "Receive visibilities straight into pipeline buffers instead of a staging buffer");
+DEFINE_int32(queue_depth, 2, "Number of integrations buffered per stream between ingest and the pipeline");
+DEFINE_string(overload, "block", "Policy when the pipeline falls behind: block, drop-oldest or drop-newest integration");
+DEFINE_string(ingest, "asio", "Receive path: asio or uring (Linux io_uring with batched receives)");
+DEFINE_int32(read_size, 0, "Bytes per receive, must divide the integration size and be a multiple of 64, 0 selects 166464 for 288 and 332352 for 576 antennas");
+DEFINE_double(replay_speed, 0.0, "Replay pacing relative to the recorded timestamps, 1 is real time and 0 as fast as possible");
+DEFINE_bool(hugepages, true, "Back integration buffers with transparent huge pages on the NUMA node of the cpu receiving the stream");
 
-class StreamTest : public Test {
+class StreamTest : public TestWithParam<std::string> {
 
 protected:
   virtual void SetUp() {
+    Stream<288>::SelectKernel(GetParam());
   }
 
   virtual void TearDown() {
   }
 };
 
-TEST_F(StreamTest, DeinterleaveIndex0) {
+/// Kernels this cpu can run, the others are not instantiated
+static std::vector<std::string> SupportedKernels()
+{
+  std::vector<std::string> names;
+  for (auto &n : deinterleave::Names())
+    if (deinterleave::Supported(n))
+      names.push_back(n);
+  return names;
+}
+
+TEST_P(StreamTest, DeinterleaveIndex0) {
   Datum s(16*sizeof(uint64_t), 0);
   Datum a(512+s.size()/2, 0);
   Datum b(512+s.size()/2, 0);
   uint64_t *sp = reinterpret_cast<uint64_t*>(s.data());
   for (int i = 0, n = s.size()/8; i < n; i++)
     sp[i] = i;
-  Stream::Deinterleave(s, a, b, 0);
+  Stream<288>::Deinterleave(s, a, b, 0);
 
   uint64_t *ap = reinterpret_cast<uint64_t*>(a.data()+512);
   uint64_t *bp = reinterpret_cast<uint64_t*>(b.data()+512);
@@ -35,7 +53,7 @@ TEST_F(StreamTest, DeinterleaveIndex0) {
     EXPECT_EQ(bp[i], i*2+1);
 }
 
-TEST_F(StreamTest, DeinterleaveFull) {
+TEST_P(StreamTest, DeinterleaveFull) {
   Datum s(41616*4*sizeof(uint64_t), 0);
   Datum a(512+s.size()/2, 0);
   Datum b(512+s.size()/2, 0);
@@ -47,7 +65,7 @@ TEST_F(StreamTest, DeinterleaveFull) {
   for (int i = 0, n = s.size()/buf.size(); i < n; i++)
   {
     memcpy(buf.data(), s.data()+i*buf.size(), buf.size());
-    Stream::Deinterleave(buf, a, b, i*buf.size()/16);
+    Stream<288>::Deinterleave(buf, a, b, i*buf.size()/16);
   }
 
   uint64_t *ap = reinterpret_cast<uint64_t*>(a.data()+512);
@@ -58,6 +76,155 @@ TEST_F(StreamTest, DeinterleaveFull) {
     EXPECT_EQ(bp[i], i*2+1);
 }
 
+TEST_P(StreamTest, DeinterleaveInPlace) {
+  Datum a(512+41616*2*sizeof(uint64_t)+166464/2, 0);
+  Datum b(a.size(), 0);
+
+  // receive each chunk in the yet unwritten part of b, like zero-copy ingest
+  for (uint64_t i = 0, k = 0, n = (a.size()-512-166464/2)*2/166464; i < n; i++)
+  {
+    uint8_t *yy = b.data()+512+i*166464/2;
+    uint64_t *sp = reinterpret_cast<uint64_t*>(yy);
+    for (int j = 0; j < 166464/8; j++, k++)
+      sp[j] = k;
+    Stream<288>::Deinterleave(yy, 166464, a.data()+512+i*166464/2, yy);
+  }
+
+  uint64_t *ap = reinterpret_cast<uint64_t*>(a.data()+512);
+  uint64_t *bp = reinterpret_cast<uint64_t*>(b.data()+512);
+  for (int i = 0, n = 41616*2; i < n; i++)
+    EXPECT_EQ(ap[i], i*2);
+  for (int i = 0, n = 41616*2; i < n; i++)
+    EXPECT_EQ(bp[i], i*2+1);
+}
+
+TEST_P(StreamTest, DeinterleaveOffsets) {
+  // outputs 32 byte aligned but at different offsets in their cache lines
+  const std::size_t n = 166464;
+  Datum s(n + 64, 0), a(n/2 + 128, 0), b(n/2 + 128, 0);
+  uint8_t *sp = s.data() + (-reinterpret_cast<uintptr_t>(s.data()) & 63);
+  uint8_t *ap = a.data() + (-reinterpret_cast<uintptr_t>(a.data()) & 63);
+  uint8_t *bp = b.data() + (-reinterpret_cast<uintptr_t>(b.data()) & 63) + 32;
+  for (std::size_t i = 0; i < n/8; i++)
+    reinterpret_cast<uint64_t*>(sp)[i] = i;
+
+  deinterleave::Select(GetParam())(sp, n, ap, bp);
+
+  for (std::size_t i = 0; i < n/16; i++)
+  {
+    ASSERT_EQ(reinterpret_cast<uint64_t*>(ap)[i], 2*i);
+    ASSERT_EQ(reinterpret_cast<uint64_t*>(bp)[i], 2*i+1);
+  }
+}
+
+/// De-interleaves 50 baselines in chunks of 90 channels, keeping ranges
+static void DeinterleaveSelected(const deinterleave::Ranges &ranges, const bool inplace) {
+  const int baselines = 50, pairs = baselines*NUM_CHANNELS, chunk = 90;
+  std::vector<uint64_t> src(2*pairs), xx(pairs, 0), yy(pairs + chunk, 0);
+  for (int i = 0; i < 2*pairs; i++)
+    src[i] = i;
+
+  std::size_t out = 0;
+  for (int q = 0; q < pairs; q += chunk)
+  {
+    uint8_t *x = reinterpret_cast<uint8_t*>(xx.data()) + out;
+    uint8_t *y = reinterpret_cast<uint8_t*>(yy.data()) + out;
+    const uint8_t *s = reinterpret_cast<const uint8_t*>(src.data() + 2*q);
+    if (inplace)
+    {
+      memcpy(y, s, 16*chunk);
+      s = y;
+    }
+    out += deinterleave::Selected(s, 16*chunk, NUM_CHANNELS, q % NUM_CHANNELS, ranges, x, y);
+  }
+
+  std::size_t k = 0;
+  for (int b = 0; b < baselines; b++)
+    for (auto &r : ranges)
+      for (int c = r.first; c <= r.second; c++, k++)
+      {
+        ASSERT_EQ(xx[k], uint64_t(2*(b*NUM_CHANNELS + c)));
+        ASSERT_EQ(yy[k], uint64_t(2*(b*NUM_CHANNELS + c) + 1));
+      }
+  EXPECT_EQ(out, 8*k);
+}
+
+TEST(StreamChannelsTest, Selected) {
+  DeinterleaveSelected({{0, 62}}, false);
+  DeinterleaveSelected({{0, 31}}, false);
+  DeinterleaveSelected({{0, 9}, {20, 40}, {62, 62}}, false);
+}
+
+TEST(StreamChannelsTest, SelectedInPlace) {
+  DeinterleaveSelected({{0, 62}}, true);
+  DeinterleaveSelected({{3, 3}, {10, 50}}, true);
+}
+
+TEST(StreamReadSizeTest, Valid) {
+  EXPECT_TRUE(Stream<288>::ValidReadSize(166464));
+  EXPECT_TRUE(Stream<288>::ValidReadSize(166464*4));
+  EXPECT_TRUE(Stream<576>::ValidReadSize(332352));
+  EXPECT_FALSE(Stream<288>::ValidReadSize(166464 + 64));
+  EXPECT_FALSE(Stream<288>::ValidReadSize(166464/2));
+  EXPECT_FALSE(Stream<576>::ValidReadSize(512));
+  EXPECT_FALSE(Stream<576>::ValidReadSize(0));
+}
+
+TEST(IntegrationQueueTest, PushPop) {
+  IntegrationQueue q(2, 8);
+  Integration out;
+  out.xx.resize(8, 0);
+  out.yy.resize(8, 0);
+  EXPECT_FALSE(q.Pop(out));
+
+  for (int i = 0; i < 2; i++)
+  {
+    Integration *in = q.Back();
+    ASSERT_NE(in, nullptr);
+    in->xx[0] = i;
+    in->yy[0] = i + 10;
+    q.Push();
+  }
+  EXPECT_EQ(q.Back(), nullptr);
+  EXPECT_EQ(q.Size(), 2);
+
+  for (int i = 0; i < 2; i++)
+  {
+    ASSERT_TRUE(q.Pop(out));
+    EXPECT_EQ(out.xx[0], i);
+    EXPECT_EQ(out.yy[0], i + 10);
+  }
+  EXPECT_EQ(q.Size(), 0);
+  EXPECT_NE(q.Back(), nullptr);
+}
+
+TEST(IntegrationQueueTest, DropOldest) {
+  IntegrationQueue q(2, 8);
+  Integration out;
+  EXPECT_FALSE(q.Drop());
+
+  for (int i = 0; i < 5; i++)
+  {
+    if (q.Back() == nullptr)
+      ASSERT_TRUE(q.Drop());
+    Integration *in = q.Back();
+    ASSERT_NE(in, nullptr);
+    in->xx[0] = in->yy[0] = i;
+    q.Push();
+  }
+
+  // only the two newest integrations survive, in order, with both polarizations
+  for (int i = 3; i < 5; i++)
+  {
+    ASSERT_TRUE(q.Pop(out));
+    EXPECT_EQ(out.xx[0], i);
+    EXPECT_EQ(out.yy[0], i);
+  }
+  EXPECT_FALSE(q.Pop(out));
+}
+
+INSTANTIATE_TEST_CASE_P(Kernels, StreamTest, ValuesIn(SupportedKernels()));
+
 int main(int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
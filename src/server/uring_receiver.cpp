@@ -0,0 +1,231 @@
+#include "uring_receiver.h"
+
+#include <glog/logging.h>
+#include <cerrno>
+#include <cstring>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/// user_data of requests that are not receives
+#define URING_INTERNAL ~0ULL
+
+static int Setup(const unsigned entries, io_uring_params *p)
+{
+  return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int Register(const int ring, const unsigned opcode, const void *arg, const unsigned n)
+{
+  return syscall(__NR_io_uring_register, ring, opcode, arg, n);
+}
+
+bool UringReceiver::Supported()
+{
+  io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  int ring = Setup(4, &p);
+  if (ring < 0)
+    return false;
+
+  close(ring);
+  return true;
+}
+
+UringReceiver::UringReceiver(const int fd, const std::size_t size, const int batch):
+  mFd(fd),
+  mBatch(batch),
+  mSubmits(0)
+{
+  CHECK(batch > 0 && batch <= 64) << "Invalid io_uring batch " << batch;
+  mOutstanding[0] = mOutstanding[1] = 0;
+
+  io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  mRing = Setup(4*batch, &p);
+  CHECK(mRing >= 0) << "io_uring_setup failed: " << strerror(errno);
+
+  mSqRingSize = p.sq_off.array + p.sq_entries*sizeof(unsigned);
+  mCqRingSize = p.cq_off.cqes + p.cq_entries*sizeof(io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+    mSqRingSize = mCqRingSize = std::max(mSqRingSize, mCqRingSize);
+
+  mSqRing = mmap(0, mSqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRing, IORING_OFF_SQ_RING);
+  CHECK(mSqRing != MAP_FAILED) << "io_uring sq ring mmap failed";
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+    mCqRing = mSqRing;
+  else
+  {
+    mCqRing = mmap(0, mCqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRing, IORING_OFF_CQ_RING);
+    CHECK(mCqRing != MAP_FAILED) << "io_uring cq ring mmap failed";
+  }
+  mSqesSize = p.sq_entries*sizeof(io_uring_sqe);
+  mSqes = static_cast<io_uring_sqe*>(mmap(0, mSqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRing, IORING_OFF_SQES));
+  CHECK(mSqes != MAP_FAILED) << "io_uring sqe mmap failed";
+
+  uint8_t *sq = static_cast<uint8_t*>(mSqRing);
+  mSqHead = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+  mSqTail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+  mSqMask = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+  mSqArray = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+  uint8_t *cq = static_cast<uint8_t*>(mCqRing);
+  mCqHead = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+  mCqTail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+  mCqMask = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+  mCqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+
+  // page aligned buffers, faulted in up front
+  long page = sysconf(_SC_PAGESIZE);
+  mSize = (size + page - 1) / page * page;
+  mBuffersSize = 2*batch*mSize;
+  mBuffers = static_cast<uint8_t*>(mmap(0, mBuffersSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0));
+  CHECK(mBuffers != MAP_FAILED) << "Failed to allocate io_uring buffers";
+
+  mEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  CHECK(mEventFd >= 0) << "eventfd failed";
+  CHECK(Register(mRing, IORING_REGISTER_EVENTFD, &mEventFd, 1) == 0) << "Failed to register eventfd: " << strerror(errno);
+
+  VLOG(1) << "io_uring receiver with " << 2*batch << " buffers of " << mSize << " bytes";
+}
+
+UringReceiver::~UringReceiver()
+{
+  // the kernel may still write to the buffers until every receive completed
+  if (mOutstanding[0] + mOutstanding[1] > 0)
+  {
+    ::shutdown(mFd, SHUT_RDWR);
+    io_uring_sqe *sqe = NextSqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+    sqe->user_data = URING_INTERNAL;
+    Enter(1, 0);
+
+    while (mOutstanding[0] + mOutstanding[1] > 0)
+    {
+      unsigned head = *mCqHead;
+      if (head == __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE))
+      {
+        Enter(0, 1);
+        continue;
+      }
+
+      uint64_t data = mCqes[head & *mCqMask].user_data;
+      if (data != URING_INTERNAL)
+        mOutstanding[data / mBatch]--;
+      __atomic_store_n(mCqHead, head + 1, __ATOMIC_RELEASE);
+    }
+  }
+
+  close(mEventFd);
+  close(mRing);
+  munmap(mSqes, mSqesSize);
+  if (mCqRing != mSqRing)
+    munmap(mCqRing, mCqRingSize);
+  munmap(mSqRing, mSqRingSize);
+  munmap(mBuffers, mBuffersSize);
+}
+
+int UringReceiver::EventFd() const
+{
+  return mEventFd;
+}
+
+uint64_t UringReceiver::Submits() const
+{
+  return mSubmits;
+}
+
+void UringReceiver::Start(Schedule schedule)
+{
+  mSchedule = schedule;
+  Queue(0);
+  Queue(1);
+}
+
+io_uring_sqe *UringReceiver::NextSqe()
+{
+  unsigned tail = *mSqTail;
+  unsigned index = tail & *mSqMask;
+  io_uring_sqe *sqe = &mSqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  mSqArray[index] = index;
+  __atomic_store_n(mSqTail, tail + 1, __ATOMIC_RELEASE);
+  return sqe;
+}
+
+void UringReceiver::Enter(const unsigned int submit, const unsigned int wait)
+{
+  int rc;
+  do
+  {
+    rc = syscall(__NR_io_uring_enter, mRing, submit, wait, wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+  }
+  while (rc < 0 && errno == EINTR);
+  CHECK(rc >= 0) << "io_uring_enter failed: " << strerror(errno);
+  mSubmits++;
+}
+
+void UringReceiver::Queue(const int group)
+{
+  // The chain only starts once everything submitted before it completed, so
+  // the two groups receive consecutive parts of the stream.
+  for (int i = 0; i < mBatch; i++)
+  {
+    int buffer = group*mBatch + i;
+    mLengths[buffer] = mSchedule();
+    CHECK(mLengths[buffer] <= mSize) << "Receive exceeds io_uring buffer";
+
+    io_uring_sqe *sqe = NextSqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = mFd;
+    sqe->addr = reinterpret_cast<uint64_t>(mBuffers + buffer*mSize);
+    sqe->len = mLengths[buffer];
+    sqe->msg_flags = MSG_WAITALL;
+    sqe->user_data = buffer;
+    if (i == 0 && mOutstanding[1 - group] > 0)
+      sqe->flags |= IOSQE_IO_DRAIN;
+    if (i < mBatch - 1)
+      sqe->flags |= IOSQE_IO_LINK;
+  }
+
+  mOutstanding[group] = mBatch;
+  Enter(mBatch, 0);
+}
+
+bool UringReceiver::Reap(Handler handler)
+{
+  unsigned head = *mCqHead;
+  unsigned tail = __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE);
+
+  for (; head != tail; head++)
+  {
+    io_uring_cqe *cqe = &mCqes[head & *mCqMask];
+    uint64_t buffer = cqe->user_data;
+    int res = cqe->res;
+    __atomic_store_n(mCqHead, head + 1, __ATOMIC_RELEASE);
+
+    if (buffer == URING_INTERNAL)
+      continue;
+
+    int group = buffer / mBatch;
+    mOutstanding[group]--;
+
+    // a short receive is the end of the stream, it breaks the chain
+    if (res != int(mLengths[buffer]))
+    {
+      if (res < 0 && res != -ECANCELED)
+        LOG(WARNING) << "io_uring receive failed: " << strerror(-res);
+      return false;
+    }
+
+    handler(mBuffers + buffer*mSize, res);
+
+    if (mOutstanding[group] == 0)
+      Queue(group);
+  }
+
+  return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <linux/io_uring.h>
+
+/**
+ * Receives a TCP byte stream with io_uring into page aligned buffers. Socket
+ * receives cannot target registered (fixed) buffers, so the buffers are plain
+ * memory that is faulted in once. The buffers are split in two groups, each
+ * group is submitted as one linked chain of MSG_WAITALL receives. The second
+ * chain is drained behind the first, so one chain is always in flight while
+ * the completions of the other are handled. The lengths of consecutive
+ * receives are given by the schedule, completions are handed out in stream
+ * order. Completions are signalled on EventFd() so the receiver can be driven
+ * from an io_service.
+ */
+class UringReceiver
+{
+public:
+  UringReceiver(const UringReceiver&) = delete;
+  UringReceiver& operator=(const UringReceiver&) = delete;
+
+  /// Length of the next receive, at most the buffer size
+  typedef std::function<std::size_t()> Schedule;
+  /// Called in stream order for every completed receive
+  typedef std::function<void(const uint8_t *data, const std::size_t length)> Handler;
+
+  UringReceiver(const int fd, const std::size_t size, const int batch);
+  ~UringReceiver();
+
+  static bool Supported();
+
+  void Start(Schedule schedule);
+  bool Reap(Handler handler);
+  int EventFd() const;
+  uint64_t Submits() const;
+
+private:
+  void Queue(const int group);
+  void Enter(const unsigned int submit, const unsigned int wait);
+  io_uring_sqe *NextSqe();
+
+  int mFd;
+  int mRing;
+  int mEventFd;
+  int mBatch;
+  std::size_t mSize;
+
+  uint8_t *mBuffers;      ///< 2*mBatch page aligned buffers of mSize bytes
+  std::size_t mBuffersSize;
+  std::size_t mLengths[2*64];
+  int mOutstanding[2];    ///< receives in flight per group
+  uint64_t mSubmits;
+  Schedule mSchedule;
+
+  void *mSqRing;
+  std::size_t mSqRingSize;
+  void *mCqRing;
+  std::size_t mCqRingSize;
+  io_uring_sqe *mSqes;
+  std::size_t mSqesSize;
+  unsigned *mSqHead, *mSqTail, *mSqMask, *mSqArray;
+  unsigned *mCqHead, *mCqTail, *mCqMask;
+  io_uring_cqe *mCqes;
+};
@@ -0,0 +1,167 @@
+#include <glog/logging.h>
+#include <gflags/gflags.h>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <thread>
+
+#include "version.h"
+#include "simulator.h"
+#include "../utils/validators.h"
+#include "../utils/antenna_positions.h"
+
+#define USAGE "[OPTION]..."
+
+DEFINE_string(antpos, "", "Antenna positions filename");
+DEFINE_int32(subband, 296, "Lofar subband that defines the frequency of the generated data");
+DEFINE_string(host, "127.0.0.1", "Host running aartfaac-calibration");
+DEFINE_int32(port, 4000, "Port aartfaac-calibration listens on for this subband");
+DEFINE_string(output, "", "Write integrations to this file instead of streaming them, for use with --replay");
+DEFINE_double(speed, 1.0, "Integrations per second relative to the correlator, 0 generates as fast as possible");
+DEFINE_int32(integrations, 0, "Number of integrations to generate, 0 generates until the connection is closed");
+DEFINE_double(start, 0.0, "Unix time of the first integration, 0 starts now");
+DEFINE_int32(seed, 1, "Seed of the gains, dead dipoles and noise");
+DEFINE_double(gain_amplitude, 0.1, "Standard deviation of the antenna gain amplitudes");
+DEFINE_double(gain_phase, 0.5, "Standard deviation of the antenna gain phases in radians");
+DEFINE_double(noise, 0.01, "Standard deviation of the visibility noise relative to the total visible flux");
+DEFINE_string(rfi, "", "Channel ranges with RFI e.g. '10-10,30-32' (inclusive)");
+DEFINE_double(rfi_power, 10.0, "Power of the RFI relative to the total visible flux");
+DEFINE_int32(dead, 0, "Number of dead dipoles");
+DEFINE_string(gains, "", "Write the injected gains to this file");
+DEFINE_bool(static, false, "Generate the visibilities once and only update the timestamps, for throughput tests");
+
+/// Writes the injected gains, one antenna per line, zero for dead dipoles
+template<int NUM_ANTENNAS>
+void WriteGains(const Simulator<NUM_ANTENNAS> &sim, const std::string &filename)
+{
+  std::ofstream file(filename);
+  CHECK(file.good()) << "Unable to write `" << filename << "'";
+
+  file << "# antenna xx.real xx.imag yy.real yy.imag" << std::endl;
+  file << std::setprecision(9);
+  for (int a = 0; a < NUM_ANTENNAS; a++)
+  {
+    file << a;
+    for (int p = 0; p < NUM_POLARIZATIONS; p++)
+      file << " " << sim.Gains(p)(a).real() << " " << sim.Gains(p)(a).imag();
+    file << std::endl;
+  }
+}
+
+/// Generates integrations for a correlator with NUM_ANTENNAS antennas
+template<int NUM_ANTENNAS>
+void Run()
+{
+  Simulator<NUM_ANTENNAS> sim(FLAGS_subband, FLAGS_seed);
+  sim.SetDeadDipoles(FLAGS_dead);
+  sim.SetGains(FLAGS_gain_amplitude, FLAGS_gain_phase);
+  sim.SetNoise(FLAGS_noise);
+
+  std::vector<int> rfi;
+  if (!FLAGS_rfi.empty())
+    for (auto &r : utils::ParseChannels(FLAGS_rfi))
+      for (int c = r.first; c <= r.second; c++)
+        rfi.push_back(c);
+  sim.SetRFI(rfi, FLAGS_rfi_power);
+
+  if (!FLAGS_gains.empty())
+    WriteGains(sim, FLAGS_gains);
+  VLOG(1) << "Subband " << FLAGS_subband << " with " << sim.DeadDipoles().size() << " dead dipoles and "
+          << rfi.size() << " RFI channels";
+
+  boost::asio::io_service io_service;
+  boost::asio::ip::tcp::socket socket(io_service);
+  std::ofstream file;
+  if (FLAGS_output.empty())
+  {
+    boost::asio::ip::tcp::resolver resolver(io_service);
+    boost::asio::connect(socket, resolver.resolve({FLAGS_host, std::to_string(FLAGS_port)}));
+    VLOG(1) << "Connected to " << FLAGS_host << ":" << FLAGS_port;
+  }
+  else
+  {
+    file.open(FLAGS_output, std::ofstream::binary);
+    CHECK(file.good()) << "Unable to write `" << FLAGS_output << "'";
+  }
+
+  double start = FLAGS_start > 0.0 ? FLAGS_start : std::floor(double(std::time(nullptr)));
+  std::vector<uint8_t> data;
+  auto begin = std::chrono::steady_clock::now();
+  int late = 0, n = 0;
+
+  for (; FLAGS_integrations == 0 || n < FLAGS_integrations; n++)
+  {
+    double time = start + n;
+    if (FLAGS_static && n > 0)
+    {
+      input_header_t *hdr = reinterpret_cast<input_header_t*>(data.data());
+      hdr->startTime = time;
+      hdr->endTime = time + 1.0;
+    }
+    else
+      sim.Generate(time, data);
+
+    if (FLAGS_speed > 0.0)
+    {
+      auto due = begin + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(n/FLAGS_speed));
+      if (std::chrono::steady_clock::now() > due)
+        late++;
+      std::this_thread::sleep_until(due);
+    }
+
+    if (file.is_open())
+      file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    else
+    {
+      boost::system::error_code ec;
+      boost::asio::write(socket, boost::asio::buffer(data), ec);
+      if (ec)
+      {
+        LOG(WARNING) << "Connection closed: " << ec.message();
+        break;
+      }
+    }
+  }
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  VLOG(1) << n << " integrations in " << seconds << " s (" << n/seconds << " per second, "
+          << n*data.size()/seconds/1e6 << " MB/s)";
+  LOG_IF(WARNING, late > 0) << late << " integrations were generated too late for --speed " << FLAGS_speed;
+}
+
+int main(int argc, char *argv[])
+{
+  FLAGS_alsologtostderr = 1;
+  FLAGS_v = 1;
+
+  ::google::RegisterFlagValidator(&FLAGS_antpos, &val::ValidateFile);
+  ::google::RegisterFlagValidator(&FLAGS_subband, &val::ValidateSubband);
+  ::google::RegisterFlagValidator(&FLAGS_port, &val::ValidatePort);
+  ::google::RegisterFlagValidator(&FLAGS_speed, &val::ValidateNonNegative);
+  ::google::RegisterFlagValidator(&FLAGS_noise, &val::ValidateNonNegative);
+  ::google::RegisterFlagValidator(&FLAGS_rfi_power, &val::ValidateNonNegative);
+  ::google::RegisterFlagValidator(&FLAGS_gain_amplitude, &val::ValidateNonNegative);
+  ::google::RegisterFlagValidator(&FLAGS_gain_phase, &val::ValidateNonNegative);
+
+  ::google::SetUsageMessage(USAGE);
+  ::google::SetVersionString(CALIBRATION_VERSION " (" CALIBRATION_BUILD ")");
+  ::google::ParseCommandLineFlags(&argc, &argv, true);
+  ::google::InitGoogleLogging(argv[0]);
+  ::google::InstallFailureSignalHandler();
+
+  CHECK(FLAGS_subband >= 0) << "No subband given";
+  CHECK(FLAGS_rfi.empty() || val::ValidateChannels("rfi", FLAGS_rfi)) << "Invalid --rfi channels";
+  CHECK(FLAGS_output.empty() || FLAGS_integrations > 0) << "--output needs --integrations";
+
+  AntennaPositions::CreateInstance(FLAGS_antpos);
+  int num_antennas = AntennaPositions::Instance()->NumAntennas();
+  VLOG(1) << "Simulating " << num_antennas << " antennas";
+  if (num_antennas == 576)
+    Run<576>();
+  else
+    Run<288>();
+
+  return 0;
+}
@@ -0,0 +1,191 @@
+#include "simulator.h"
+
+#include <glog/logging.h>
+#include <algorithm>
+#include <cstring>
+
+#include "../utils/antenna_positions.h"
+#include "../utils/ateam.h"
+
+#define C_MS 299792458.0f
+
+template<int NUM_ANTENNAS>
+Simulator<NUM_ANTENNAS>::Simulator(const int subband, const unsigned int seed):
+  mSubband(subband),
+  mGenerator(seed),
+  mNoise(0.0f),
+  mRFIPower(0.0f),
+  mRFIChannels(NUM_CHANNELS, false)
+{
+  CHECK(ANT_ITRF().rows() == NUM_ANTENNAS) << "Antenna positions do not match " << NUM_ANTENNAS << " antennas";
+
+  utils::ATeam(mRaSources, mDecSources, mEpoch);
+  mFluxes = utils::ATeamFluxes();
+  mACM.resize(NUM_ANTENNAS, NUM_ANTENNAS);
+
+  for (int p = 0; p < NUM_POLARIZATIONS; p++)
+    mGains[p] = VectorXcf::Ones(NUM_ANTENNAS);
+}
+
+/**
+ * @brief
+ * Draws per antenna gains with the given amplitude and phase (radians)
+ * spread, normalized the way the calibrator reports them: unit mean
+ * amplitude and a real first antenna
+ */
+template<int NUM_ANTENNAS>
+void Simulator<NUM_ANTENNAS>::SetGains(const float amplitude, const float phase)
+{
+  for (int p = 0; p < NUM_POLARIZATIONS; p++)
+  {
+    for (int a = 0; a < NUM_ANTENNAS; a++)
+      mGains[p](a) = std::polar(std::max(0.1f, 1.0f + amplitude*mNormal(mGenerator)), phase*mNormal(mGenerator));
+
+    mGains[p] /= mGains[p].cwiseAbs().mean();
+    mGains[p] *= std::polar(1.0f, -std::arg(mGains[p](0)));
+  }
+
+  for (int a : mDeadDipoles)
+    mGains[0](a) = mGains[1](a) = 0.0f;
+}
+
+template<int NUM_ANTENNAS>
+void Simulator<NUM_ANTENNAS>::SetNoise(const float sigma)
+{
+  mNoise = sigma;
+}
+
+template<int NUM_ANTENNAS>
+void Simulator<NUM_ANTENNAS>::SetRFI(const std::vector<int> &channels, const float power)
+{
+  std::fill(mRFIChannels.begin(), mRFIChannels.end(), false);
+  for (int c : channels)
+  {
+    CHECK(c >= 0 && c < NUM_CHANNELS) << "Invalid RFI channel " << c;
+    mRFIChannels[c] = true;
+  }
+  mRFIPower = power;
+}
+
+/**
+ * @brief
+ * Picks count random dipoles that produce no signal, their gains are zero
+ */
+template<int NUM_ANTENNAS>
+void Simulator<NUM_ANTENNAS>::SetDeadDipoles(const int count)
+{
+  CHECK(count >= 0 && count < NUM_ANTENNAS) << "Invalid number of dead dipoles " << count;
+
+  std::vector<int> all(NUM_ANTENNAS);
+  for (int a = 0; a < NUM_ANTENNAS; a++)
+    all[a] = a;
+  std::shuffle(all.begin(), all.end(), mGenerator);
+  mDeadDipoles.assign(all.begin(), all.begin()+count);
+  std::sort(mDeadDipoles.begin(), mDeadDipoles.end());
+
+  for (int a : mDeadDipoles)
+    mGains[0](a) = mGains[1](a) = 0.0f;
+}
+
+template<int NUM_ANTENNAS>
+const VectorXcf &Simulator<NUM_ANTENNAS>::Gains(const int polarization) const
+{
+  return mGains[polarization];
+}
+
+template<int NUM_ANTENNAS>
+const std::vector<int> &Simulator<NUM_ANTENNAS>::DeadDipoles() const
+{
+  return mDeadDipoles;
+}
+
+/// Size in bytes of one integration on the wire
+template<int NUM_ANTENNAS>
+std::size_t Simulator<NUM_ANTENNAS>::Size()
+{
+  return sizeof(input_header_t) + Config<NUM_ANTENNAS>::NUM_BASELINES*NUM_POLARIZATIONS*NUM_CHANNELS*sizeof(std::complex<float>);
+}
+
+/**
+ * @brief
+ * Selects the A-team sources above the horizon at the central time of the
+ * integration, using the same horizon cut as the Calibrator
+ */
+template<int NUM_ANTENNAS>
+void Simulator<NUM_ANTENNAS>::Model(const double time)
+{
+  static const Vector3d normal(0.598753, 0.072099, 0.797682); ///< Normal to CS002 (central antenna)
+
+  double jd = utils::UnixTime2MJD(time + 0.5) / 86400.0 + 2400000.5;
+  utils::sunRaDec(jd, mRaSources(4), mDecSources(4));
+
+  MatrixXd src_pos(mRaSources.rows(), 3);
+  utils::radec2itrf<double>(mRaSources, mDecSources, mEpoch, jd, src_pos);
+  VectorXd up = src_pos * normal;
+
+  int n = (up.array() > 0.1).count();
+  MatrixXd selection(n, 3);
+  mVisibleFluxes.resize(n);
+  for (int i = 0, j = 0; i < src_pos.rows(); i++)
+  {
+    if (up(i) > 0.1)
+    {
+      selection.row(j) = src_pos.row(i);
+      mVisibleFluxes(j) = mFluxes(i);
+      j++;
+    }
+  }
+
+  mPhases = ANT_ITRF() * selection.transpose();
+}
+
+/**
+ * @brief
+ * Renders the integration starting at unix time into out, the header is
+ * followed by the lower triangle visibilities in the correlator order
+ */
+template<int NUM_ANTENNAS>
+void Simulator<NUM_ANTENNAS>::Generate(const double time, std::vector<uint8_t> &out)
+{
+  out.resize(Size());
+  Model(time);
+
+  input_header_t hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = INPUT_MAGIC;
+  hdr.startTime = time;
+  hdr.endTime = time + 1.0;
+  std::fill(hdr.weights, hdr.weights+Config<NUM_ANTENNAS>::NUM_WEIGHTS, 1);
+  memcpy(out.data(), &hdr, sizeof(hdr));
+
+  // receiver noise on the autocorrelations, the sky dominates at LBA
+  float total = mVisibleFluxes.sum();
+  float sigma = mNoise*total/std::sqrt(2.0f);
+  std::complex<float> *vis = reinterpret_cast<std::complex<float>*>(out.data() + sizeof(input_header_t));
+
+  for (int c = 0; c < NUM_CHANNELS; c++)
+  {
+    std::complex<double> i1(0.0, 2.0 * M_PI * utils::Channel2Frequency(mSubband, c+1) / C_MS);
+    MatrixXcf A = (-i1 * mPhases).array().exp().template cast<std::complex<float>>();
+    mACM.noalias() = A * mVisibleFluxes.asDiagonal() * A.adjoint();
+    mACM.diagonal().array() += total;
+
+    std::complex<float> rfi = mRFIChannels[c] ? mRFIPower*total : 0.0f;
+    for (int p = 0; p < NUM_POLARIZATIONS; p++)
+    {
+      const VectorXcf &g = mGains[p];
+      for (int i = 0, b = 0; i < NUM_ANTENNAS; i++)
+      {
+        for (int j = 0; j <= i; j++, b++)
+        {
+          std::complex<float> v = g(i) * (mACM(i, j) + rfi) * std::conj(g(j));
+          if (g(i) != 0.0f && g(j) != 0.0f)
+            v += std::complex<float>(sigma*mNormal(mGenerator), sigma*mNormal(mGenerator));
+          vis[(b*NUM_CHANNELS + c)*NUM_POLARIZATIONS + p] = v;
+        }
+      }
+    }
+  }
+}
+
+INSTANTIATE_ANTENNAS(Simulator)
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <complex>
+#include <random>
+#include <vector>
+
+#include "../config.h"
+#include "../server/packet.h"
+
+using namespace Eigen;
+
+/**
+ * Synthesises correlator output for a single subband. The sky is the A-team
+ * at the catalogue positions used by the Calibrator, observed by the array in
+ * AntennaPositions through known per antenna complex gains:
+ *
+ *   R = G A S A^H G^H + N
+ *
+ * with additive receiver noise, optional RFI channels and dead dipoles. An
+ * integration is rendered in the input wire format, an input_header_t
+ * followed by the visibilities per baseline per channel with XX and YY
+ * interleaved, so it can be streamed to or replayed by aartfaac-calibration.
+ */
+template<int NUM_ANTENNAS>
+class Simulator
+{
+public:
+  Simulator(const int subband, const unsigned int seed);
+
+  void SetGains(const float amplitude, const float phase);
+  void SetNoise(const float sigma);
+  void SetRFI(const std::vector<int> &channels, const float power);
+  void SetDeadDipoles(const int count);
+
+  void Generate(const double time, std::vector<uint8_t> &out);
+
+  const VectorXcf &Gains(const int polarization) const;
+  const std::vector<int> &DeadDipoles() const;
+  static std::size_t Size();
+
+private:
+  void Model(const double time);
+
+  int mSubband;
+  std::mt19937 mGenerator;
+  std::normal_distribution<float> mNormal;
+
+  VectorXcf mGains[NUM_POLARIZATIONS]; ///< injected gains, zero for dead dipoles
+  VectorXd mRaSources;
+  VectorXd mDecSources;
+  VectorXi mEpoch;
+  VectorXf mFluxes;
+  MatrixXd mPhases;                    ///< geometric delay in meters per antenna and visible source
+  VectorXf mVisibleFluxes;
+  MatrixXcf mACM;
+
+  float mNoise;                        ///< noise sigma relative to the total visible flux
+  float mRFIPower;                     ///< RFI power relative to the total visible flux
+  std::vector<bool> mRFIChannels;
+  std::vector<int> mDeadDipoles;
+};
@@ -0,0 +1,93 @@
+#include "../simulator.h"
+#include "../../utils/antenna_positions.h"
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+
+using namespace ::testing;
+
+typedef std::complex<float> cf;
+
+class SimulatorTest : public Test {
+
+protected:
+  static void SetUpTestCase() {
+    std::string dir(__FILE__);
+    dir = dir.substr(0, dir.rfind('/'));
+    AntennaPositions::CreateInstance(dir + "/../../../data/antennasets/lba_outer.dat");
+  }
+
+  /// Visibility of antennas (i, j), j <= i, in channel c and polarization p
+  cf Vis(const std::vector<uint8_t> &data, const int i, const int j, const int c, const int p) {
+    const cf *vis = reinterpret_cast<const cf*>(data.data() + sizeof(input_header_t));
+    return vis[((i*(i+1)/2 + j)*NUM_CHANNELS + c)*NUM_POLARIZATIONS + p];
+  }
+
+  /// Mean visibility power of channel c
+  float Power(const std::vector<uint8_t> &data, const int c) {
+    float power = 0.0f;
+    for (int i = 0; i < 288; i++)
+      for (int j = 0; j <= i; j++)
+        power += std::norm(Vis(data, i, j, c, 0));
+    return power / Config<288>::NUM_BASELINES;
+  }
+};
+
+TEST_F(SimulatorTest, Header) {
+  Simulator<288> sim(296, 1);
+  std::vector<uint8_t> data;
+  sim.Generate(1.5e9, data);
+
+  const input_header_t *hdr = reinterpret_cast<const input_header_t*>(data.data());
+  ASSERT_EQ(data.size(), Simulator<288>::Size());
+  EXPECT_EQ(hdr->magic, INPUT_MAGIC);
+  EXPECT_EQ(hdr->startTime, 1.5e9);
+  EXPECT_EQ(hdr->endTime, 1.5e9 + 1.0);
+}
+
+TEST_F(SimulatorTest, Gains) {
+  Simulator<288> sim(296, 1);
+  sim.SetGains(0.2f, 1.0f);
+  std::vector<uint8_t> data;
+  sim.Generate(1.5e9, data);
+
+  // both polarizations observe the same sky through their own gains
+  const VectorXcf &gx = sim.Gains(0), &gy = sim.Gains(1);
+  EXPECT_NEAR(gx.cwiseAbs().mean(), 1.0f, 1e-4f);
+  EXPECT_NEAR(std::arg(gx(0)), 0.0f, 1e-5f);
+  for (int i = 0; i < 288; i += 7)
+    for (int j = 0; j <= i; j += 5)
+      for (int c = 0; c < NUM_CHANNELS; c += 31)
+      {
+        cf x = Vis(data, i, j, c, 0) / (gx(i) * std::conj(gx(j)));
+        cf y = Vis(data, i, j, c, 1) / (gy(i) * std::conj(gy(j)));
+        EXPECT_NEAR(std::abs(x - y), 0.0f, 1e-3f*std::abs(x));
+      }
+}
+
+TEST_F(SimulatorTest, DeadDipoles) {
+  Simulator<288> sim(296, 1);
+  sim.SetDeadDipoles(4);
+  sim.SetNoise(0.01f);
+  std::vector<uint8_t> data;
+  sim.Generate(1.5e9, data);
+
+  ASSERT_EQ(sim.DeadDipoles().size(), 4u);
+  std::vector<bool> dead(288, false);
+  for (int a : sim.DeadDipoles())
+    dead[a] = true;
+
+  for (int i = 0; i < 288; i++)
+    for (int j = 0; j <= i; j++)
+      for (int p = 0; p < NUM_POLARIZATIONS; p++)
+        EXPECT_EQ(Vis(data, i, j, 10, p) == cf(0.0f), dead[i] || dead[j]);
+}
+
+TEST_F(SimulatorTest, RFI) {
+  Simulator<288> sim(296, 1);
+  sim.SetRFI({20}, 10.0f);
+  std::vector<uint8_t> data;
+  sim.Generate(1.5e9, data);
+
+  EXPECT_GT(Power(data, 20), 10.0f*Power(data, 19));
+  EXPECT_GT(Power(data, 20), 10.0f*Power(data, 21));
+}
@@ -14,24 +14,28 @@ AntennaPositions::AntennaPositions(const std::string &filename)
   if (!file.good())
     LOG(ERROR) << "`" << filename << "' Invalid antennapositions";
 
-  mPosItrf.resize(NUM_ANTENNAS, 3);
-
   std::vector<std::string> list;
+  std::vector<Vector3d> positions;
   std::string line;
-  int idx = 0;
   while (std::getline(file, line))
   {
     if (line[0] == '#' || line.size() == 0)
       continue;
 
     boost::split(list, line, boost::is_any_of(" "));
+    Vector3d p;
     for (int i = 0; i < 3; i++)
-      mPosItrf(idx, i) = std::atof(list[i].c_str());
-    idx++;
+      p(i) = std::atof(list[i].c_str());
+    positions.push_back(p);
   }
   file.close();
 
-  CHECK(idx == NUM_ANTENNAS) << " - " << idx << " != " << NUM_ANTENNAS;
+  int idx = positions.size();
+  CHECK(idx == 288 || idx == 576) << " - " << idx << " antennas, expected 288 or 576";
+
+  mPosItrf.resize(idx, 3);
+  for (int i = 0; i < idx; i++)
+    mPosItrf.row(i) = positions[i];
 
   // Rotation matrix taken from AntennaField.conf file from CS002
   Matrix3d rot_mat;
@@ -41,13 +45,13 @@ AntennaPositions::AntennaPositions(const std::string &filename)
 
   mPosLocal = mPosItrf * rot_mat;
 
-  mUCoords.resize(NUM_ANTENNAS, NUM_ANTENNAS);
-  mVCoords.resize(NUM_ANTENNAS, NUM_ANTENNAS);
-  mWCoords.resize(NUM_ANTENNAS, NUM_ANTENNAS);
+  mUCoords.resize(idx, idx);
+  mVCoords.resize(idx, idx);
+  mWCoords.resize(idx, idx);
 
-  for (int a1 = 0; a1 < NUM_ANTENNAS; a1++)
+  for (int a1 = 0; a1 < idx; a1++)
   {
-    for (int a2 = 0; a2 < NUM_ANTENNAS; a2++)
+    for (int a2 = 0; a2 < idx; a2++)
     {
       mUCoords(a1, a2) = mPosItrf(a1, 0) - mPosItrf(a2, 0);
       mVCoords(a1, a2) = mPosItrf(a1, 1) - mPosItrf(a2, 1);
@@ -21,6 +21,8 @@ public:
   MatrixXd& GetAllV() { return mVCoords; }
   MatrixXd& GetAllW() { return mWCoords; }
 
+  int NumAntennas() { return mPosItrf.rows(); }
+
   MatrixXd& GetAllITRF() { return mPosItrf; }
   MatrixXd& GetAllLocal() { return mPosLocal; }
 
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Eigen/Dense>
+
+using namespace Eigen;
+
+namespace utils
+{
+
+/** Number of A-team sources: Cassiopeia A, Cygnus A, Taurus A, Virgo A and the Sun */
+constexpr int NUM_ATEAM = 5;
+
+/**
+ * @brief
+ * Catalogue positions (radians) and epochs (1 = B1950, 0 = J2000) of the
+ * A-team sources. The Sun moves, its position is left at zero here and is
+ * computed per integration with sunRaDec.
+ */
+inline void ATeam(VectorXd &outRa, VectorXd &outDec, VectorXi &outEpoch)
+{
+  outRa.resize(NUM_ATEAM);
+  outDec.resize(NUM_ATEAM);
+  outEpoch.resize(NUM_ATEAM);
+
+  // Cassiopeia A (11000 flux)
+  outRa(0)   = 6.113786558863104;
+  outDec(0)  = 1.021919365863547;
+
+  // Cygnus A (8100 flux)
+  outRa(1)   = 5.226192095556169;
+  outDec(1)  = 0.7086036763096979;
+
+  // Tauras A (1420 flux)
+  outRa(2)   = 1.446441617590301;
+  outDec(2)  = 0.3835070143048873;
+
+  // Virgo A (970 flux)
+  outRa(3)   = 3.265074698168392;
+  outDec(3)  = 0.221104127406815;
+
+  // Sun
+  outRa(4)   = 0.0;
+  outDec(4)  = 0.0;
+
+  outEpoch.setOnes();
+  outEpoch(4) = 0;
+}
+
+/**
+ * @brief
+ * Nominal A-team fluxes in Jy in the order of ATeam, the Sun is given its
+ * quiet sun flux at LBA frequencies
+ */
+inline VectorXf ATeamFluxes()
+{
+  VectorXf fluxes(NUM_ATEAM);
+  fluxes << 11000.0f, 8100.0f, 1420.0f, 970.0f, 5000.0f;
+  return fluxes;
+}
+
+} // namespace utils
@@ -0,0 +1,31 @@
+#include "../sigmaclip.h"
+#include <benchmark/benchmark.h>
+#include <random>
+
+/// Clips gaussian data with 3% outliers, as the channel and antenna powers look
+static void BM_SigmaClip(benchmark::State &state)
+{
+  const int n = state.range(0);
+  std::mt19937 gen(42);
+  std::normal_distribution<float> normal(10.0f, 2.0f);
+  std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+  VectorXf data(n), mask(n), scratch;
+  for (int i = 0; i < n; i++)
+    data(i) = uniform(gen) < 0.03f ? normal(gen)*10.0f : normal(gen);
+
+  int iterations = 0;
+  for (auto _ : state)
+  {
+    mask.setOnes();
+    iterations = utils::SigmaClip(data, mask, scratch, 3.0f);
+    benchmark::DoNotOptimize(mask.data());
+  }
+
+  state.SetItemsProcessed(int64_t(state.iterations()) * n);
+  state.counters["clip_iterations"] = iterations;
+}
+
+BENCHMARK(BM_SigmaClip)->Arg(63)->Arg(288)->Arg(576)->Arg(4096)->Arg(41616)->Arg(166176);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * Runtime selection between the instruction set specific variants of a
+ * kernel. A module lists its variants slowest first with the features each
+ * one needs, "auto" or a variant this cpu cannot run resolves to the last
+ * one it can.
+ */
+namespace cpu
+{
+enum Feature : unsigned
+{
+  SSE41 = 1 << 0,
+  AVX2 = 1 << 1,
+  FMA = 1 << 2,
+  AVX512F = 1 << 3
+};
+
+/// Features of the cpu this runs on
+inline unsigned Features()
+{
+  __builtin_cpu_init();
+
+  unsigned features = 0;
+  if (__builtin_cpu_supports("sse4.1"))
+    features |= SSE41;
+  if (__builtin_cpu_supports("avx2"))
+    features |= AVX2;
+  if (__builtin_cpu_supports("fma"))
+    features |= FMA;
+  if (__builtin_cpu_supports("avx512f"))
+    features |= AVX512F;
+  return features;
+}
+
+template<typename Kernel>
+struct Variant
+{
+  std::string name;
+  unsigned features; ///< every Feature the kernel uses
+  Kernel kernel;
+};
+
+/// Names of all variants, fastest last
+template<typename Kernel>
+std::vector<std::string> Names(const std::vector<Variant<Kernel>> &variants)
+{
+  std::vector<std::string> names;
+  for (auto &v : variants)
+    names.push_back(v.name);
+  return names;
+}
+
+/// True when the variant exists and the cpu supports it, "auto" is always supported
+template<typename Kernel>
+bool Supported(const std::vector<Variant<Kernel>> &variants, const std::string &name)
+{
+  if (name == "auto")
+    return true;
+
+  for (auto &v : variants)
+    if (v.name == name)
+      return (v.features & Features()) == v.features;
+  return false;
+}
+
+/// The variant name selects, "auto" and unsupported names give the fastest supported one
+template<typename Kernel>
+std::string Resolve(const std::vector<Variant<Kernel>> &variants, const std::string &name)
+{
+  if (name != "auto" && Supported(variants, name))
+    return name;
+
+  for (auto v = variants.rbegin(); v != variants.rend(); v++)
+    if (Supported(variants, v->name))
+      return v->name;
+  return variants.front().name;
+}
+
+/// The kernel of the variant Resolve picks
+template<typename Kernel>
+Kernel Select(const std::vector<Variant<Kernel>> &variants, const std::string &name)
+{
+  auto n = Resolve(variants, name);
+  for (auto &v : variants)
+    if (v.name == n)
+      return v.kernel;
+  return variants.front().kernel;
+}
+}
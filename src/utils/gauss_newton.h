@@ -0,0 +1,96 @@
+#pragma once
+
+/*
+ * Gauss-Newton minimization of a sum of squares, of which the caller knows
+ * the gradient and the Gauss-Newton approximation J^T J of the hessian. Every
+ * step solves the normal equations and is shortened by a backtracking line
+ * search on the Armijo condition until it decreases the function. When the
+ * approximation is not positive definite the step falls back to steepest
+ * descent.
+ *
+ * fun(x) returns the function value at x, fun(x, gradient, hessian) also
+ * fills the derivatives. The search stops when the full step is at most
+ * tolerance relative to x, in the same 1 norm as the size of the simplex of
+ * NM::Simplex so both stop at a comparable precision, or when no step along
+ * the search direction decreases the function.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <Eigen/Dense>
+
+namespace NLS
+{
+
+using namespace Eigen;
+
+template<typename D, typename F>
+Matrix<D, Dynamic, 1> GaussNewton(
+        F &fun,                      // target function and derivatives
+        Matrix<D, Dynamic, 1> x,     // initial params
+        int &iteration,              // iterations used
+  const D tolerance = 1e-5,          // termination criteria
+  const int iterations = 1e3         // max iterations
+)
+{
+  typedef Matrix<D, Dynamic, Dynamic> MatX; // Matrix
+  typedef Matrix<D, Dynamic, 1> VecX;       // Vector
+
+  const D armijo = 1e-4;
+  const int max_backtracks = 10;
+
+  VecX g, d, x_new;
+  MatX H;
+  D f = fun(x, g, H);
+
+  iteration = 0;
+  while (true)
+  {
+    iteration++;
+
+    // Max iterations reached, break from the loop
+    if (iteration > iterations)
+      break;
+
+    LDLT<MatX> ldlt(H);
+    d = ldlt.solve(-g);
+    D slope = g.dot(d);
+    if (ldlt.info() != Success || !d.allFinite() || !(slope < 0))
+    {
+      d = -g / std::max(H.diagonal().maxCoeff(), std::numeric_limits<D>::min());
+      slope = g.dot(d);
+      if (!(slope < 0))
+        break;
+    }
+
+    // Test for convergence, close to the minimum the full step is trusted
+    // as the function does not decrease beyond its rounding errors there
+    if (d.template lpNorm<1>() / std::max(x.template lpNorm<1>(), D(1.0)) <= tolerance)
+    {
+      x += d;
+      break;
+    }
+
+    D t = 1.0;
+    int k = 0;
+    for (; k < max_backtracks; k++, t *= 0.5)
+    {
+      x_new = x + t * d;
+      if (fun(x_new) <= f + armijo * t * slope)
+        break;
+    }
+
+    // no decrease along the search direction, x is as good as it gets
+    if (k == max_backtracks)
+      break;
+
+    x = x_new;
+    f = fun(x, g, H);
+  }
+
+  return x;
+}
+
+}
@@ -0,0 +1,99 @@
+#include "placement.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/// Size of a transparent huge page
+#define HUGE_PAGE (2UL << 20)
+/// Memory policy and flag of mbind(2), numaif.h is not always installed
+#define MPOL_PREFERRED 1
+#define MPOL_MF_MOVE (1 << 1)
+
+namespace placement
+{
+static std::mutex sMutex;
+static std::set<const void*> sPlaced;
+static std::atomic<uint64_t> sBytes(0);
+static std::atomic<uint64_t> sAdvised(0);
+static std::atomic<uint64_t> sBound(0);
+
+int Node(const int cpu)
+{
+  const std::string nodes("/sys/devices/system/node/node");
+  for (int node = 0; access((nodes + std::to_string(node)).c_str(), F_OK) == 0; node++)
+    if (access((nodes + std::to_string(node) + "/cpu" + std::to_string(cpu)).c_str(), F_OK) == 0)
+      return node;
+  return -1;
+}
+
+bool Place(void *data, const std::size_t size, const int node)
+{
+  {
+    std::lock_guard<std::mutex> lock(sMutex);
+    if (!sPlaced.insert(data).second)
+      return false;
+  }
+  sBytes += size;
+
+  // huge pages only cover the 2 MB aligned interior of the buffer
+  uintptr_t begin = reinterpret_cast<uintptr_t>(data);
+  uintptr_t end = begin + size;
+  uintptr_t hbegin = (begin + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1);
+  uintptr_t hend = end & ~(HUGE_PAGE - 1);
+  if (hend > hbegin && madvise(reinterpret_cast<void*>(hbegin), hend - hbegin, MADV_HUGEPAGE) == 0)
+    sAdvised += hend - hbegin;
+
+  if (node < 0)
+    return true;
+
+  uintptr_t page = sysconf(_SC_PAGESIZE);
+  uintptr_t pbegin = (begin + page - 1) & ~(page - 1);
+  uintptr_t pend = end & ~(page - 1);
+  unsigned long mask[16] = {0};
+  if (pend <= pbegin || node >= int(sizeof(mask)*8))
+    return true;
+
+  mask[node / 64] = 1UL << (node % 64);
+  if (syscall(SYS_mbind, pbegin, pend - pbegin, MPOL_PREFERRED, mask, sizeof(mask)*8, MPOL_MF_MOVE) == 0)
+    sBound += pend - pbegin;
+
+  return true;
+}
+
+/// Value of a line in a file like /proc/meminfo, the first number after key
+static long Lookup(const char *path, const std::string &key)
+{
+  std::ifstream f(path);
+  std::string line;
+  while (std::getline(f, line))
+    if (line.compare(0, key.size(), key) == 0)
+      return std::atol(line.c_str() + key.size());
+  return -1;
+}
+
+std::string Report()
+{
+  std::string thp;
+  std::ifstream f("/sys/kernel/mm/transparent_hugepage/enabled");
+  if (!std::getline(f, thp))
+    thp = "unavailable";
+
+  std::stringstream ss;
+  ss << (sBytes >> 20) << " MB placed, " << (sAdvised >> 20) << " MB advised huge pages (" << thp << "), ";
+  ss << (sBound >> 20) << " MB bound to a node, ";
+  long huge = Lookup("/proc/self/smaps_rollup", "AnonHugePages:");
+  if (huge < 0)
+    ss << "unknown in huge pages";
+  else
+    ss << (huge >> 10) << " MB in huge pages";
+  return ss.str();
+}
+}
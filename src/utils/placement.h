@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Placement of the large integration buffers. The allocator of a Datum
+ * belongs to the pipeline library, so buffers are placed after allocation:
+ * the page aligned part is advised to use transparent huge pages and bound
+ * to a NUMA node, pages that are already present are migrated there. Every
+ * step is best effort, a kernel without huge pages or NUMA support leaves
+ * the buffer as it was.
+ */
+namespace placement
+{
+/// NUMA node of cpu, -1 if unknown
+int Node(const int cpu);
+
+/// Places a buffer once, later calls for the same buffer return false
+bool Place(void *data, const std::size_t size, const int node);
+
+/// What was asked for and what the kernel gave so far
+std::string Report();
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <limits>
 #include <Eigen/Dense>
 
 using namespace std;
@@ -9,24 +10,7 @@ using namespace Eigen;
 namespace utils
 {
 
-template<typename I, typename P>
-auto StablePartitionPosition(I f, I l, P p) -> I
-{
-  auto n = l - f;
-  if (n == 0) return f;
-  if (n == 1) return f + p(f);
-
-  auto m = f + (n / 2);
-
-  auto a = StablePartitionPosition(f, m, p);
-  auto b = StablePartitionPosition(m, l, p);
-
-  rotate(a, m, b);
-  return a + (b - m);
-}
-
-
-float Median(Ref<VectorXf> data)
+inline float Median(Ref<VectorXf> data)
 {
   int n = data.rows();
   int h = n >> 1;
@@ -45,41 +29,87 @@ float Median(Ref<VectorXf> data)
 }
 
 
-float Sigma(Ref<VectorXf> data)
+inline float Sigma(Ref<VectorXf> data)
 {
   return sqrt((data.array() - data.mean()).square().sum() * (1.0f / data.rows()));
 }
 
 
+/**
+ * @brief
+ * Iteratively clears mask for the elements of data more than n sigma from
+ * the median of the elements still in the mask, until no element is
+ * rejected. Returns the number of iterations.
+ *
+ * The elements in the mask are kept in scratch in their original order, each
+ * iteration only filters the survivors of the previous one. Median and sigma
+ * are computed on an aligned copy exactly as before, so the result does not
+ * depend on the order of evaluation. scratch grows to twice the size of data
+ * once and is reused by later calls.
+ */
 template<int MaxIter = 100>
-int SigmaClip(Ref<VectorXf> data, Ref<VectorXf> mask, float n = 2.0f)
+int SigmaClip(Ref<VectorXf> data, Ref<VectorXf> mask, VectorXf &scratch, float n = 2.0f)
 {
-  VectorXf copy(data);
-  float median, sigma, sum;
+  const int rows = data.rows();
+  const int offset = (rows + 15) & ~15;
+  if (scratch.rows() < offset + rows)
+    scratch.resize(offset + rows);
+
+  float *remains = scratch.data();
+  float *work = scratch.data() + offset;
+
+  int count = 0;
+  for (int i = 0; i < rows; i++)
+  {
+    remains[count] = data(i);
+    count += int(mask(i)) != 0;
+  }
+
+  float lo = -numeric_limits<float>::infinity();
+  float hi = numeric_limits<float>::infinity();
+  int iterations = MaxIter;
 
   for (int i = 0; i < MaxIter; i++)
   {
-    auto p = StablePartitionPosition(copy.data(), copy.data() + copy.rows(), [&](float *i)
+    if (count == 0)
     {
-      return int(*(mask.data() + (i - copy.data())));
-    });
+      iterations = i;
+      break;
+    }
 
-    Map<VectorXf, Aligned> remains(copy.data(), int(p - copy.data()));
+    Map<VectorXf, Aligned> w(work, count);
+    copy(remains, remains + count, work);
 
-    median = Median(remains);
-    sigma = Sigma(remains);
-    sum = mask.sum();
+    float median = Median(w);
+    float sigma = Sigma(w);
+    float l = median - n * sigma;
+    float h = median + n * sigma;
 
-    mask = (data.array() < median - n * sigma || data.array() > median + n * sigma).select(VectorXf::Zero(mask.rows()),
-                                                                                           mask);
+    int kept = 0;
+    for (int j = 0; j < count; j++)
+    {
+      float x = remains[j];
+      remains[kept] = x;
+      kept += !(x < l || x > h);
+    }
 
-    if (sum == mask.sum())
-      return i;
+    if (kept == count)
+    {
+      iterations = i;
+      break;
+    }
 
-    copy = data;
+    lo = max(lo, l);
+    hi = min(hi, h);
+    count = kept;
   }
 
-  return MaxIter;
+  // an element survives when it passed the bounds of every iteration
+  for (int i = 0; i < rows; i++)
+    if (data(i) < lo || data(i) > hi)
+      mask(i) = 0.0f;
+
+  return iterations;
 }
 
 } // namespace utils
@@ -0,0 +1,90 @@
+#include "../gauss_newton.h"
+#include "../NMSMax.h"
+#include <gtest/gtest.h>
+
+using namespace ::testing;
+using namespace Eigen;
+
+/// The Rosenbrock function as the sum of squares of r = (10 (x1 - x0^2), 1 - x0), minimum zero in (1, 1)
+struct Rosenbrock
+{
+  Rosenbrock(): evaluations(0) {}
+
+  double operator()(const VectorXd &x) {
+    evaluations++;
+    return 100.0 * std::pow(x(1) - x(0)*x(0), 2) + std::pow(1.0 - x(0), 2);
+  }
+
+  double operator()(const VectorXd &x, VectorXd &gradient, MatrixXd &hessian) {
+    Vector2d r(10.0 * (x(1) - x(0)*x(0)), 1.0 - x(0));
+    Matrix2d J;
+    J << -20.0 * x(0), 10.0,
+         -1.0,         0.0;
+    gradient = 2.0 * J.transpose() * r;
+    hessian = 2.0 * J.transpose() * J;
+    return (*this)(x);
+  }
+
+  int evaluations;
+};
+
+/// Linear least squares, where the Gauss-Newton step is exact
+struct Linear
+{
+  Linear(const int n): J(MatrixXd::Random(2*n, n)), b(VectorXd::Random(2*n)) {}
+
+  double operator()(const VectorXd &x) {
+    return (J * x - b).squaredNorm();
+  }
+
+  double operator()(const VectorXd &x, VectorXd &gradient, MatrixXd &hessian) {
+    gradient = 2.0 * J.transpose() * (J * x - b);
+    hessian = 2.0 * J.transpose() * J;
+    return (*this)(x);
+  }
+
+  MatrixXd J;
+  VectorXd b;
+};
+
+TEST(GaussNewtonTest, Rosenbrock) {
+  Rosenbrock fun;
+  int iterations = 0;
+  VectorXd x = NLS::GaussNewton(fun, VectorXd(Vector2d(-1.2, 1.0)), iterations, 1e-8, 1000);
+  EXPECT_NEAR(x(0), 1.0, 1e-6);
+  EXPECT_NEAR(x(1), 1.0, 1e-6);
+  EXPECT_LT(iterations, 20);
+
+  // far fewer evaluations than the simplex needs for the same minimum
+  Rosenbrock simplex;
+  int cycles = 0;
+  VectorXd y = NM::Simplex(simplex, VectorXd(Vector2d(-1.2, 1.0)), cycles, 1e-8, 1000);
+  EXPECT_NEAR(y(0), 1.0, 1e-3);
+  EXPECT_LT(fun.evaluations, simplex.evaluations);
+}
+
+TEST(GaussNewtonTest, Linear) {
+  Linear fun(6);
+  int iterations = 0;
+  VectorXd x = NLS::GaussNewton(fun, VectorXd(VectorXd::Zero(6)), iterations, 1e-10, 1000);
+  VectorXd expected = fun.J.colPivHouseholderQr().solve(fun.b);
+  EXPECT_LT((x - expected).lpNorm<Infinity>(), 1e-9);
+  EXPECT_LE(iterations, 2);
+}
+
+TEST(GaussNewtonTest, Iterations) {
+  Rosenbrock fun;
+  int iterations = 0;
+  NLS::GaussNewton(fun, VectorXd(Vector2d(-1.2, 1.0)), iterations, 1e-8, 2);
+  EXPECT_EQ(iterations, 3);
+}
+
+TEST(GaussNewtonTest, Singular) {
+  // no curvature in the second parameter, which the step leaves alone
+  Linear fun(2);
+  fun.J.col(1).setZero();
+  int iterations = 0;
+  VectorXd x = NLS::GaussNewton(fun, VectorXd(VectorXd::Zero(2)), iterations, 1e-10, 1000);
+  EXPECT_TRUE(x.allFinite());
+  EXPECT_NEAR(x(0), fun.J.col(0).dot(fun.b) / fun.J.col(0).squaredNorm(), 1e-6);
+}
@@ -0,0 +1,107 @@
+#include "../sigmaclip.h"
+#include <gtest/gtest.h>
+#include <random>
+
+using namespace ::testing;
+
+namespace reference
+{
+/// The original clipper, which partitioned a copy of data every iteration
+template<typename I, typename P>
+auto StablePartitionPosition(I f, I l, P p) -> I
+{
+  auto n = l - f;
+  if (n == 0) return f;
+  if (n == 1) return f + p(f);
+
+  auto m = f + (n / 2);
+
+  auto a = StablePartitionPosition(f, m, p);
+  auto b = StablePartitionPosition(m, l, p);
+
+  rotate(a, m, b);
+  return a + (b - m);
+}
+
+int SigmaClip(Ref<VectorXf> data, Ref<VectorXf> mask, float n)
+{
+  VectorXf copy(data);
+  float median, sigma, sum;
+
+  for (int i = 0; i < 100; i++)
+  {
+    auto p = StablePartitionPosition(copy.data(), copy.data() + copy.rows(), [&](float *i)
+    {
+      return int(*(mask.data() + (i - copy.data())));
+    });
+
+    Map<VectorXf, Aligned> remains(copy.data(), int(p - copy.data()));
+
+    median = utils::Median(remains);
+    sigma = utils::Sigma(remains);
+    sum = mask.sum();
+
+    mask = (data.array() < median - n * sigma || data.array() > median + n * sigma).select(VectorXf::Zero(mask.rows()),
+                                                                                           mask);
+
+    if (sum == mask.sum())
+      return i;
+
+    copy = data;
+  }
+
+  return 100;
+}
+}
+
+class SigmaClipTest : public TestWithParam<int> {
+
+protected:
+  /// Gaussian data with a few percent outliers and a few elements masked beforehand
+  void Generate(const int seed, VectorXf &data, VectorXf &mask) {
+    std::mt19937 gen(seed);
+    std::normal_distribution<float> normal(10.0f, 2.0f);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+    data.resize(GetParam());
+    mask.resize(GetParam());
+    for (int i = 0; i < data.rows(); i++)
+    {
+      float u = uniform(gen);
+      data(i) = u < 0.03f ? normal(gen)*10.0f : normal(gen);
+      mask(i) = u > 0.98f ? 0.0f : 1.0f;
+    }
+  }
+
+  VectorXf mScratch;
+};
+
+TEST_P(SigmaClipTest, Identical) {
+  for (int seed = 0; seed < 20; seed++)
+  {
+    VectorXf data, mask;
+    Generate(seed, data, mask);
+    VectorXf expected(mask);
+    float n = 1.5f + 0.25f*(seed % 8);
+
+    int iterations = reference::SigmaClip(data, expected, n);
+    EXPECT_EQ(utils::SigmaClip(data, mask, mScratch, n), iterations);
+    ASSERT_TRUE(mask == expected) << "seed " << seed;
+  }
+}
+
+TEST_P(SigmaClipTest, Constant) {
+  VectorXf data = VectorXf::Constant(GetParam(), 3.0f);
+  VectorXf mask = VectorXf::Ones(GetParam());
+  EXPECT_EQ(utils::SigmaClip(data, mask, mScratch, 2.0f), 0);
+  EXPECT_EQ(mask.sum(), GetParam());
+}
+
+TEST_P(SigmaClipTest, AllMasked) {
+  VectorXf data = VectorXf::Random(GetParam());
+  VectorXf mask = VectorXf::Zero(GetParam());
+  EXPECT_EQ(utils::SigmaClip(data, mask, mScratch, 2.0f), 0);
+  EXPECT_EQ(mask.sum(), 0.0f);
+}
+
+INSTANTIATE_TEST_CASE_P(Sizes, SigmaClipTest, Values(1, 2, 63, 64, 288, 576, 4097, 41616));
@@ -111,6 +111,39 @@ std::vector<std::pair<int,int>> ParseChannels(const std::string &value)
   return channels;
 }
 
+std::vector<std::pair<int,int>> ParseSubbands(const std::string &value)
+{
+  std::vector<std::pair<int,int>> subbands;
+  std::size_t start = 0;
+
+  if (value.empty())
+    return subbands;
+
+  // every entry is subband:port, anything else becomes -1:-1
+  while (true)
+  {
+    std::size_t end = value.find(',', start);
+    std::string entry = value.substr(start, end == std::string::npos ? end : end - start);
+    std::size_t colon = entry.find(':');
+
+    bool valid = colon != std::string::npos && colon > 0 && colon + 1 < entry.size() &&
+        entry.find(':', colon + 1) == std::string::npos;
+    for (std::size_t i = 0; valid && i < entry.size(); i++)
+      valid = i == colon || std::isdigit(entry[i]);
+
+    if (valid)
+      subbands.push_back(std::make_pair(std::atoi(entry.substr(0, colon).c_str()), std::atoi(entry.substr(colon + 1).c_str())));
+    else
+      subbands.push_back(std::make_pair(-1, -1));
+
+    if (end == std::string::npos)
+      break;
+    start = end + 1;
+  }
+
+  return subbands;
+}
+
 void sunRaDec(const double inJD, double &outRa, double &outDec)
 {
   double n = inJD - 2451545.0;
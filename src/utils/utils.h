@@ -4,6 +4,8 @@
 #include <utility>
 #include <iostream>
 #include <complex>
+#include <string>
+#include <vector>
 #include <Eigen/Dense>
 
 using namespace Eigen;
@@ -98,6 +100,7 @@ int PopCount(uint64_t x);
 
 std::vector<std::pair<int,int>> ParseChannels(const std::string &value);
 std::vector<int> ParseAffinity(const std::string &value);
+std::vector<std::pair<int,int>> ParseSubbands(const std::string &value);
 
 /**
  * @brief MJDs2JD
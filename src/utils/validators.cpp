@@ -1,5 +1,8 @@
 #include "validators.h"
 #include "utils.h"
+#include "../config.h"
+#include "../server/deinterleave.h"
+#include "../server/uring_receiver.h"
 
 #include <vector>
 #include <fstream>
@@ -18,7 +21,26 @@ bool ValidatePort(const char *flagname, const int value)
 bool ValidateSubband(const char *flagname, const int value)
 {
   (void) flagname;
-  return value >= 0 && value < 512;
+  // -1 leaves the subband to --subbands
+  return value >= -1 && value < 512;
+}
+
+bool ValidateSubbands(const char *flagname, const std::string &value)
+{
+  auto subbands = utils::ParseSubbands(value);
+  std::vector<int> ports;
+
+  // malformed entries are parsed as -1:-1
+  for (auto &s : subbands)
+  {
+    if (!ValidateSubband(flagname, s.first) || s.first < 0 || !ValidatePort(flagname, s.second))
+      return false;
+    if (std::find(ports.begin(), ports.end(), s.second) != ports.end())
+      return false;
+    ports.push_back(s.second);
+  }
+
+  return true;
 }
 
 bool ValidateAffinity(const char *flagname, const std::string &value)
@@ -31,6 +53,12 @@ bool ValidateAffinity(const char *flagname, const std::string &value)
   return v.size() >= 2;
 }
 
+bool ValidateThreads(const char *flagname, const int value)
+{
+  (void) flagname;
+  return value > 0;
+}
+
 bool ValidateSigma(const char *flagname, const double value)
 {
   (void) flagname;
@@ -43,12 +71,107 @@ bool ValidateAntCfg(const char *flagname, const int value)
   return value >= 0 && value <= 3;
 }
 
+bool ValidateKernel(const char *flagname, const std::string &value)
+{
+  (void) flagname;
+  return deinterleave::Supported(value);
+}
+
+bool ValidateBuffer(const char *flagname, const int value)
+{
+  (void) flagname;
+  return value > 0;
+}
+
+bool ValidateQueueDepth(const char *flagname, const int value)
+{
+  (void) flagname;
+  return value > 0 && value <= 64;
+}
+
+bool ValidateOverload(const char *flagname, const std::string &value)
+{
+  (void) flagname;
+  return value == "block" || value == "drop-oldest" || value == "drop-newest";
+}
+
+bool ValidateAntennaPower(const char *flagname, const std::string &value)
+{
+  (void) flagname;
+  return value == "acm" || value == "auto" || value == "compare";
+}
+
+bool ValidatePositionSolver(const char *flagname, const std::string &value)
+{
+  (void) flagname;
+  return value == "simplex" || value == "gauss-newton";
+}
+
+bool ValidateIngest(const char *flagname, const std::string &value)
+{
+  (void) flagname;
+  return value == "asio" || (value == "uring" && UringReceiver::Supported());
+}
+
+bool ValidateReadSize(const char *flagname, const int value)
+{
+  (void) flagname;
+  // the integration size depends on the antenna count, see Stream::ValidReadSize
+  return value == 0 || (value > 0 && value % 64 == 0);
+}
+
+bool ValidateReplay(const char *flagname, const std::string &value)
+{
+  if (value.empty())
+    return true;
+
+  std::vector<std::string> list;
+  boost::split(list, value, boost::is_any_of(","));
+
+  bool valid = true;
+  for (auto &s : list)
+    valid = valid && ValidateFile(flagname, s);
+  return valid;
+}
+
+bool ValidateNonNegative(const char *flagname, const double value)
+{
+  (void) flagname;
+  return value >= 0.0;
+}
+
+bool ValidateRFIWindow(const char *flagname, const int value)
+{
+  (void) flagname;
+  return value >= 0 && value <= 15;
+}
+
+bool ValidateCpuList(const char *flagname, const std::string &value)
+{
+  (void) flagname;
+  return value.find_first_not_of("0123456789,") == std::string::npos;
+}
+
+bool ValidateAntennaList(const char *flagname, const std::string &value)
+{
+  if (value.empty())
+    return true;
+
+  if (!ValidateCpuList(flagname, value))
+    return false;
+
+  for (auto a : utils::ParseAffinity(value))
+    if (a >= 576)
+      return false;
+  return true;
+}
+
 bool ValidateChannels(const char *flagname, const std::string &value)
 {
   (void) flagname;
   auto ranges = utils::ParseChannels(value);
 
-  if (ranges.empty())
+  if (ranges.empty() || ranges.front().first < 0 || ranges.back().second >= NUM_CHANNELS)
     return false;
 
   auto &a = ranges[0];
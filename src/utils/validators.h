@@ -6,10 +6,25 @@ namespace val
 {
 bool ValidateOutput(const char *flagname, const std::string &value);
 bool ValidateSubband(const char *flagname, const int value);
+bool ValidateSubbands(const char *flagname, const std::string &value);
 bool ValidatePort(const char *flagname, const int value);
 bool ValidateAffinity(const char *flagname, const std::string &value);
+bool ValidateThreads(const char *flagname, const int value);
 bool ValidateChannels(const char *flagname, const std::string &value);
 bool ValidateSigma(const char *flagname, const double value);
 bool ValidateFile(const char *flagname, const std::string &value);
 bool ValidateAntCfg(const char *flagname, const int value);
+bool ValidateKernel(const char *flagname, const std::string &value);
+bool ValidateBuffer(const char *flagname, const int value);
+bool ValidateQueueDepth(const char *flagname, const int value);
+bool ValidateOverload(const char *flagname, const std::string &value);
+bool ValidateAntennaPower(const char *flagname, const std::string &value);
+bool ValidatePositionSolver(const char *flagname, const std::string &value);
+bool ValidateIngest(const char *flagname, const std::string &value);
+bool ValidateReadSize(const char *flagname, const int value);
+bool ValidateReplay(const char *flagname, const std::string &value);
+bool ValidateNonNegative(const char *flagname, const double value);
+bool ValidateRFIWindow(const char *flagname, const int value);
+bool ValidateCpuList(const char *flagname, const std::string &value);
+bool ValidateAntennaList(const char *flagname, const std::string &value);
 }